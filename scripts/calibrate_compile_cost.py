@@ -0,0 +1,122 @@
+#!/usr/bin/python3
+###############################################################################
+#
+# Copyright (c) 2020, Intel Corporation
+# Copyright (c) 2020, University of Utah
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###############################################################################
+"""
+Script for calibration of the compile cost estimate of yarpgen.
+It generates a corpus of tests, compiles each of them and fits the compile
+time as a linear function of the compile_cost from gen_stats.json. The result
+is the budget for --max-compile-cost that corresponds to the target time.
+"""
+###############################################################################
+
+import argparse
+import json
+import math
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+###############################################################################
+
+func_file_ext = {"c": "c", "c++": "cpp", "ispc": "ispc", "sycl": "cpp"}
+
+
+def gen_test(yarpgen, std, seed, out_dir):
+    cmd = [yarpgen, "--std=" + std, "-s", str(seed), "-o", out_dir, "--stats=true"]
+    subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+    with open(os.path.join(out_dir, "gen_stats.json"), "r") as stats_file:
+        return json.load(stats_file)["compile_cost"]
+
+
+def compile_test(compiler, flags, std, out_dir, timeout):
+    func_file = os.path.join(out_dir, "func." + func_file_ext[std])
+    cmd = [compiler] + flags.split() + ["-c", func_file, "-o", os.path.join(out_dir, "func.o")]
+    start = time.monotonic()
+    try:
+        subprocess.run(cmd, check=True, timeout=timeout, stdout=subprocess.DEVNULL,
+                       stderr=subprocess.DEVNULL)
+    except subprocess.TimeoutExpired:
+        return None
+    except subprocess.CalledProcessError:
+        print("Compilation failed: " + " ".join(cmd), file=sys.stderr)
+        return None
+    return time.monotonic() - start
+
+
+def fit(points):
+    """Least squares fit of time = k * cost, and the correlation of the two"""
+    k = sum(cost * secs for cost, secs in points) / sum(cost * cost for cost, _ in points)
+    n = len(points)
+    mean_cost = sum(cost for cost, _ in points) / n
+    mean_secs = sum(secs for _, secs in points) / n
+    cov = sum((cost - mean_cost) * (secs - mean_secs) for cost, secs in points)
+    var_cost = sum((cost - mean_cost) ** 2 for cost, _ in points)
+    var_secs = sum((secs - mean_secs) ** 2 for _, secs in points)
+    corr = cov / math.sqrt(var_cost * var_secs) if var_cost and var_secs else 0
+    return k, corr
+
+
+def calibrate(args):
+    out_dir = tempfile.mkdtemp(prefix="yarpgen_calibrate_")
+    points = []
+    try:
+        for seed in range(args.first_seed, args.first_seed + args.seeds):
+            cost = gen_test(args.yarpgen, args.std, seed, out_dir)
+            secs = compile_test(args.compiler, args.flags, args.std, out_dir, args.timeout)
+            if secs is None:
+                print("seed {}: cost {}, skipped".format(seed, cost))
+                continue
+            print("seed {}: cost {}, {:.2f} s".format(seed, cost, secs))
+            points.append((cost, secs))
+    finally:
+        shutil.rmtree(out_dir)
+
+    if len(points) < 2:
+        sys.exit("Not enough tests to fit the model")
+    k, corr = fit(points)
+    print("\nSeconds per cost unit: {:.3g}".format(k))
+    print("Correlation: {:.3f}".format(corr))
+    print("--max-compile-cost={} for the target time of {} s".format(
+          int(args.target_time / k), args.target_time))
+
+###############################################################################
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument("--yarpgen", dest="yarpgen", default="yarpgen", type=str,
+                        help="Path to yarpgen binary")
+    parser.add_argument("--std", dest="std", default="c++", choices=sorted(func_file_ext.keys()),
+                        help="Language standard of the tests")
+    parser.add_argument("--compiler", dest="compiler", default="clang++", type=str,
+                        help="Compiler that is used for calibration")
+    parser.add_argument("--flags", dest="flags", default="-O3", type=str,
+                        help="Compiler flags")
+    parser.add_argument("--first-seed", dest="first_seed", default=1, type=int,
+                        help="First seed of the corpus")
+    parser.add_argument("--seeds", dest="seeds", default=50, type=int,
+                        help="Number of tests in the corpus")
+    parser.add_argument("--timeout", dest="timeout", default=600, type=int,
+                        help="Compilation timeout (in seconds). Tests that exceed it are skipped")
+    parser.add_argument("--target-time", dest="target_time", default=600, type=float,
+                        help="Compile time that the budget should correspond to (in seconds)")
+    calibrate(parser.parse_args())
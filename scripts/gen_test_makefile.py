@@ -189,6 +189,58 @@ class StatisticsOptions (object):
         except KeyError:
             common.print_and_exit("Can't find key!" + spec)
 
+###############################################################################
+# Section for shared driver
+# Driver is the same for all of the targets, so it can be compiled once per
+# test and linked with func object of every target. Targets can share driver
+# object only if they use the same compiler and agree on the options that
+# affect ABI, code model, or runtime libraries, so they are split into groups.
+# Driver object of the group is built without optimization and ISA options.
+
+driver_abi_flags_re = re.compile(r"^(-m32|-m64|-mx32|-mcmodel=\S+|-fpic|-fPIC|-fpie|-fPIE|-fsycl\S*|-fsanitize=\S+|"
+                                 r"-D\S+|/M[DT]d?)$")
+
+# Maps the name of the target to the name of the driver object that it uses.
+# It is filled by gen_makefile() in shared driver mode.
+driver_obj_names = dict()
+
+
+class DriverGroup (object):
+    def __init__(self, name, compiler_name, args):
+        self.name = name
+        self.compiler_name = compiler_name
+        self.args = args
+        self.obj_name = "shared_" + name + "_driver.o"
+
+
+def get_compiler_name(target):
+    if common.selected_standard.is_c():
+        return target.specs.comp_c_name
+    if common.selected_standard.is_cxx():
+        return target.specs.comp_cxx_name
+    return None
+
+
+def get_driver_abi_flags(target):
+    return tuple(flag for flag in target.args.split() if driver_abi_flags_re.match(flag))
+
+
+# Returns the list of groups and the map from target name to its group
+def split_into_driver_groups(targets):
+    groups = []
+    group_keys = dict()
+    target_groups = dict()
+    for target in targets:
+        abi_flags = get_driver_abi_flags(target)
+        key = (get_compiler_name(target), abi_flags)
+        if key not in group_keys:
+            common_args = target.specs.common_args.split()
+            args = common_args + [flag for flag in abi_flags if flag not in common_args]
+            group_keys[key] = DriverGroup(target.name, key[0], " ".join(args))
+            groups.append(group_keys[key])
+        target_groups[target.name] = group_keys[key]
+    return groups, target_groups
+
 ###############################################################################
 # Section for config parser
 
@@ -305,7 +357,7 @@ def detect_native_arch():
 
 
 def gen_makefile(out_file_name, force, config_file, only_target=None, inject_blame_opt=None, inject_blame_env=None,
-                 creduce_file=None, stat_targets=None):
+                 creduce_file=None, stat_targets=None, shared_driver=False):
     # Somebody can prepare test specs and target, so we don't need to parse config file
     common.check_if_std_defined()
     if config_file is not None:
@@ -333,14 +385,18 @@ def gen_makefile(out_file_name, force, config_file, only_target=None, inject_bla
     output += "\n"
 
     # 3. Define build targets
-    for target in CompilerTarget.all_targets:
-        if only_target is not None and only_target.name != target.name:
-            continue
-        compiler_name = None
-        if common.selected_standard.is_c():
-            compiler_name = target.specs.comp_c_name
-        if common.selected_standard.is_cxx():
-            compiler_name = target.specs.comp_cxx_name
+    makefile_targets = [target for target in CompilerTarget.all_targets
+                        if only_target is None or only_target.name == target.name]
+    driver_groups = []
+    target_driver_groups = dict()
+    driver_obj_names.clear()
+    if shared_driver:
+        driver_groups, target_driver_groups = split_into_driver_groups(makefile_targets)
+        for target_name, group in target_driver_groups.items():
+            driver_obj_names[target_name] = group.obj_name
+
+    for target in makefile_targets:
+        compiler_name = get_compiler_name(target)
         output += target.name + ": " + "COMPILER=\"" + compiler_name + "\"\n"
 
         optflags_str = target.name + ": " + "OPTFLAGS=" + target.args
@@ -349,7 +405,8 @@ def gen_makefile(out_file_name, force, config_file, only_target=None, inject_bla
         optflags_str += "\n"
         output += optflags_str
         # For performance reasons driver should always be compiled with -O0
-        output += re.sub("/O\d", "/O0", (optflags_str.replace("OPTFLAGS", "DRIVER_OPTFLAGS")))
+        if not shared_driver:
+            output += re.sub("/O\d", "/O0", (optflags_str.replace("OPTFLAGS", "DRIVER_OPTFLAGS")))
 
         if inject_blame_opt is not None:
             output += target.name + ": " + "BLAMEOPTS=" + inject_blame_opt + "\n"
@@ -361,11 +418,14 @@ def gen_makefile(out_file_name, force, config_file, only_target=None, inject_bla
                               StatisticsOptions.get_options(target.specs) + "\n"
                     stat_targets.remove(stat_target)
         output += target.name + ": " + "EXECUTABLE=" + target.name + "_" + executable.value + "\n"
-        output += target.name + ": " + "$(addprefix " + target.name + "_,"
-        if common.selected_standard != common.StdID.ISPC:
-            output += "$(SOURCES:" + common.get_file_ext() + "=.o))\n"
+        if shared_driver:
+            output += target.name + ": " + target.name + "_func.o " + target_driver_groups[target.name].obj_name + "\n"
         else:
-            output += "$(patsubst %.ispc,%.o," + "$(SOURCES:" + common.get_file_ext() + "=.o))" + ")\n"
+            output += target.name + ": " + "$(addprefix " + target.name + "_,"
+            if common.selected_standard != common.StdID.ISPC:
+                output += "$(SOURCES:" + common.get_file_ext() + "=.o))\n"
+            else:
+                output += "$(patsubst %.ispc,%.o," + "$(SOURCES:" + common.get_file_ext() + "=.o))" + ")\n"
         output += "\t" + "$(COMPILER) $(LDFLAGS) $(STDFLAGS) $(OPTFLAGS) /Fe:$(EXECUTABLE).exe $^\n\n"
 
     if stat_targets is not None and len(stat_targets) != 0:
@@ -392,6 +452,20 @@ def gen_makefile(out_file_name, force, config_file, only_target=None, inject_bla
                 output += " $(BLAMEOPTS) "
         output += "\n\n"
 
+    # Explicit rules take precedence over the pattern rule above. Shared driver
+    # objects are not forced, so every target of the group reuses the object
+    # until the test is regenerated.
+    for group in driver_groups:
+        driver_source = common.append_file_ext("driver")
+        source_prefix = "$(TEST_PWD)/" if creduce_file and creduce_file != driver_source else ""
+        output += group.obj_name + ": " + "COMPILER=\"" + group.compiler_name + "\"\n"
+        output += group.obj_name + ": " + "DRIVER_OPTFLAGS=" + group.args + "\n"
+        output += group.obj_name + ": " + source_prefix + driver_source
+        for header in headers.value.split():
+            output += " " + source_prefix + header
+        output += "\n"
+        output += "\t" + "$(COMPILER) $(CXXFLAGS) $(STDFLAGS) $(DRIVER_OPTFLAGS) /Fe:$@.exe -c $<\n\n"
+
     output += "clean:\n"
     output += "\trm *.o *_$(EXECUTABLE)\n\n"
 
@@ -453,6 +527,8 @@ if __name__ == '__main__':
                         help="Source file to reduce")
     parser.add_argument("--collect-stat", dest="collect_stat", default="", type=str,
                         help="List of testing sets for statistics collection")
+    parser.add_argument("--shared-driver", dest="shared_driver", default=False, action="store_true",
+                        help="Compile driver once for each group of ABI-compatible testing sets")
     args = parser.parse_args()
 
     log_level = logging.DEBUG if args.verbose else logging.INFO
@@ -462,4 +538,4 @@ if __name__ == '__main__':
     common.set_standard(args.std_str)
     set_standard()
     gen_makefile(os.path.abspath(args.out_file), args.force, args.config_file, creduce_file=args.creduce_file,
-                 stat_targets=args.collect_stat.split())
+                 stat_targets=args.collect_stat.split(), shared_driver=args.shared_driver)
@@ -24,6 +24,7 @@ Script for autonomous testing with YARP Generator
 
 import argparse
 import datetime
+import json
 import logging
 import math
 import multiprocessing
@@ -135,6 +136,9 @@ compfail = "compfail"
 compfail_timeout = "compfail_timeout"
 out_dif = "different_output"
 
+# Generation statistics that yarpgen writes with --stats
+gen_stats_file_name = "gen_stats.json"
+
 
 class StatsParser(object):
     """All parsers should return obtained data in form of list of tuples:
@@ -159,6 +163,33 @@ class StatsParser(object):
         inp_file.close()
         return result
 
+    @staticmethod
+    def parse_yarpgen_stats_file(inp_file_name):
+        """Flattens generation statistics that yarpgen writes with --stats"""
+        common.log_msg(logging.DEBUG, "Parsing generation statistics file: " + inp_file_name)
+        inp_file = common.check_and_open_file(inp_file_name, 'r')
+        try:
+            gen_stats = json.load(inp_file)
+        except ValueError:
+            common.log_msg(logging.WARNING, "Can't parse generation statistics file: " + inp_file_name)
+            return None
+        finally:
+            inp_file.close()
+        result = []
+        for name, value in gen_stats.items():
+            if name == "seed":
+                continue
+            if name == "phases":
+                for phase, phase_stats in value.items():
+                    result.append(("phase_" + phase + "_time_ms", phase_stats["time_ms"]))
+                    result.append(("phase_" + phase + "_calls", phase_stats["calls"]))
+            elif isinstance(value, dict):
+                result += [(name + "_" + sub_name, sub_value) for sub_name, sub_value in value.items()]
+            else:
+                result.append((name, value))
+        common.log_msg(logging.DEBUG, "Finished parsing of generation statistics file: " + inp_file_name)
+        return result
+
     @staticmethod
     def parse_clang_stmt_stats_file(inp_str):
         common.log_msg(logging.DEBUG, "Parsing statement statistics")
@@ -205,10 +236,15 @@ class Test(object):
     # stat is statistics object
     # seed is optional, if we want to generate some particular seed.
     # proc_num is optional debug info to track in what process we are running this activity.
-    def __init__(self, stat, seed="", proc_num=-1, blame=False, creduce_makefile=None):
+    # yarpgen_args is optional list of additional generator options.
+    def __init__(self, stat, seed="", proc_num=-1, blame=False, creduce_makefile=None, yarpgen_args=None):
         # Run generator
         yarpgen_run_list = [".." + os.sep + "yarpgen",
                             "--std=" + common.StdID.get_pretty_std_name(common.selected_standard)]
+        if yarpgen_args:
+            yarpgen_run_list += yarpgen_args
+        if stat.get_collect_stats_enabled():
+            yarpgen_run_list += ["--stats=true"]
         if seed:
             yarpgen_run_list += ["-s", seed]
         self.yarpgen_cmd = " ".join(str(p) for p in yarpgen_run_list)
@@ -219,6 +255,8 @@ class Test(object):
         # Generator may report them in output later and we may need to parse it.
         self.files = gen_test_makefile.sources.value.split() + gen_test_makefile.headers.value.split()
         self.files.append(gen_test_makefile.Test_Makefile_name)
+        if os.path.isfile(gen_stats_file_name):
+            self.files.append(gen_stats_file_name)
 
         # Parse generated seed.
         if not seed:
@@ -252,6 +290,9 @@ class Test(object):
         else:
             self.status = self.STATUS_ok
             stat.update_yarpgen_runs(ok)
+            if os.path.isfile(gen_stats_file_name):
+                gen_stats = StatsParser.parse_yarpgen_stats_file(gen_stats_file_name)
+                stat.add_gen_stats(gen_stats)
 
         # Initialize set of test runs
         self.successful_test_runs = []
@@ -878,6 +919,8 @@ class TestRun(object):
         expected_files = [source + ".o" for source in gen_test_makefile.sources.value.split()]
         expected_files.append(gen_test_makefile.executable.value)
         expected_files = [self.optset + "_" + e for e in expected_files]
+        if self.optset in gen_test_makefile.driver_obj_names:
+            expected_files.append(gen_test_makefile.driver_obj_names[self.optset])
         if self.parse_stats:
             expected_files.append("func.stats")
         for f in expected_files:
@@ -1126,19 +1169,23 @@ class CmdRun (object):
 class StatsVault(object):
     opt_stats_id = 0
     stmt_stats_id = 1
+    gen_stats_id = 2
 
     @staticmethod
     def id_to_str(id):
-        return "opt_stats" if id == StatsVault.opt_stats_id else "stmt_stats"
+        if id == StatsVault.opt_stats_id:
+            return "opt_stats"
+        if id == StatsVault.stmt_stats_id:
+            return "stmt_stats"
+        return "gen_stats"
 
     def __init__(self, target_name):
         self.target_name = target_name
         self.stats = dict()
-        self.stats[StatsVault.opt_stats_id] = {}
-        self.stats[StatsVault.stmt_stats_id] = {}
         self.stats_num = dict()
-        self.stats_num[StatsVault.opt_stats_id] = 0
-        self.stats_num[StatsVault.stmt_stats_id] = 0
+        for id in [StatsVault.opt_stats_id, StatsVault.stmt_stats_id, StatsVault.gen_stats_id]:
+            self.stats[id] = {}
+            self.stats_num[id] = 0
 
     def add_stats(self, new_stats, id):
         for i in new_stats:
@@ -1174,6 +1221,8 @@ class Statistics (object):
         for i in gen_test_makefile.CompilerTarget.all_targets:
             self.target_runs[i.name] = CmdRun(i.name)
             self.stats_vault[i.name] = StatsVault(i.name)
+        # Generation statistics don't depend on the target
+        self.gen_stats_vault = StatsVault("yarpgen")
         self.seeds_pass = None
         self.seeds_fail = None
         self.collect_stats_enabled = False
@@ -1235,6 +1284,16 @@ class Statistics (object):
     def is_stat_collected(self, target_name):
         return self.stats_vault[target_name].is_stats_collected()
 
+    def add_gen_stats(self, gen_stats):
+        if gen_stats is not None:
+            self.gen_stats_vault.add_stats(gen_stats, StatsVault.gen_stats_id)
+
+    def get_gen_stats(self):
+        return self.gen_stats_vault.get_stats(StatsVault.gen_stats_id)
+
+    def is_gen_stat_collected(self):
+        return self.gen_stats_vault.stats_num[StatsVault.gen_stats_id] != 0
+
     def set_collect_stats_enabled(self, val):
         self.collect_stats_enabled = val
 
@@ -1354,6 +1413,10 @@ def form_statistics(stat, targets, prev_len, tasks=None):
             verbose_stat_str += "Statement statistics: \n"
             verbose_stat_str += stat.get_stats(i.name, StatsVault.stmt_stats_id) + "\n"
             stmt_stats_list.append(stat.get_total_stats_num(i.name, StatsVault.stmt_stats_id))
+    if stat.is_gen_stat_collected():
+        verbose_stat_str += "\n=================================\n"
+        verbose_stat_str += "Generation statistics (sum over the seeds): \n"
+        verbose_stat_str += stat.get_gen_stats() + "\n"
     verbose_stat_str += "\n=================================\n"
 
     active = 0
@@ -1506,7 +1569,7 @@ def proccess_seeds(seeds_option_value):
     return unique_seeds
 
 def prepare_env_and_start_testing(out_dir, timeout, targets, num_jobs, config_file, seeds_option_value, blame, creduce,
-                                  no_tmp_cln, collect_stat):
+                                  no_tmp_cln, collect_stat, shared_driver, yarpgen_args):
     common.check_if_std_defined()
     common.check_dir_and_create(out_dir)
 
@@ -1537,7 +1600,8 @@ def prepare_env_and_start_testing(out_dir, timeout, targets, num_jobs, config_fi
         out_file_name = makefile,
         force = True,
         config_file = config_file,
-        stat_targets=collect_stat.split())
+        stat_targets=collect_stat.split(),
+        shared_driver=shared_driver)
 
     test_sets = dump_testing_sets(targets)
     missed_stat_targets = [x for x in collect_stat.split() if x not in test_sets]
@@ -1579,7 +1643,8 @@ def prepare_env_and_start_testing(out_dir, timeout, targets, num_jobs, config_fi
     for num in range(num_jobs):
         task_threads[num] = multiprocessing.Process(target=gen_and_test,
                                                     args=(num, makefile, lock, end_time, task_queue, stat, targets,
-                                                          blame, creduce_makefile, collect_stat.split()))
+                                                          blame, creduce_makefile, collect_stat.split(),
+                                                          yarpgen_args))
         task_threads[num].start()
 
     print_online_statistics_and_cleanup(lock, stat, targets, task_threads, num_jobs, no_tmp_cln)
@@ -1594,7 +1659,8 @@ def prepare_env_and_start_testing(out_dir, timeout, targets, num_jobs, config_fi
     sys.stdout.flush()
 
 
-def gen_and_test(num, makefile, lock, end_time, task_queue, stat, targets, blame, creduce_makefile, stat_targets):
+def gen_and_test(num, makefile, lock, end_time, task_queue, stat, targets, blame, creduce_makefile, stat_targets,
+                 yarpgen_args):
     common.log_msg(logging.DEBUG, "Job #" + str(num))
     os.chdir(process_dir + str(num))
     work_dir = os.getcwd()
@@ -1626,7 +1692,7 @@ def gen_and_test(num, makefile, lock, end_time, task_queue, stat, targets, blame
         # Generate the test.
         # TODO: maybe, it is better to call generator through Makefile?
         test = Test(stat=stat, seed=seed, proc_num=num, blame=blame,
-                    creduce_makefile=creduce_makefile)
+                    creduce_makefile=creduce_makefile, yarpgen_args=yarpgen_args)
         if not test.is_ok():
             test.save(lock)
             continue
@@ -1753,6 +1819,25 @@ Use specified folder for testing
                         help="List of testing sets for statistics collection")
     parser.add_argument("--ignore-comp-time-exp", dest="ignore_comp_time_exp", default=True, action="store_true",
                         help="Don't save files (except log-file) when compile time expires")
+    parser.add_argument("--shared-driver", dest="shared_driver", default=False, action="store_true",
+                        help="Compile driver once per test for each group of ABI-compatible testing sets "
+                             "and link it with func object of every testing set in the group")
+    parser.add_argument("--compact-driver", dest="compact_driver", default=False, action="store_true",
+                        help="Generate tests with table-driven driver, so its build time doesn't depend on the test")
+    parser.add_argument("--gen-time-budget", dest="gen_time_budget", default=False, action="store_true",
+                        help="Reduce the generation policy when the generator nears its timeout. "
+                             "Such tests depend on the machine, the header of the test records "
+                             "the option that reproduces it")
+    parser.add_argument("--gen-mem-budget", dest="gen_mem_budget", default=False, action="store_true",
+                        help="Reduce the generation policy when the IR of the generator nears "
+                             "a quarter of its memory limit")
+    parser.add_argument("--max-dyn-ops", dest="max_dyn_ops", default=0, type=int,
+                        help="Budget of the estimated number of operations that the test executes. "
+                             "E.g., 2000000000 keeps the test far below the run timeout, even under emulation. "
+                             "Zero means no limit")
+    parser.add_argument("--max-compile-cost", dest="max_compile_cost", default=0, type=int,
+                        help="Budget of the estimated compile cost of the test. It depends on the compilers, "
+                             "use calibrate_compile_cost.py to find it. Zero means no limit")
     args = parser.parse_args()
 
     log_level = logging.DEBUG if args.verbose else logging.INFO
@@ -1778,6 +1863,18 @@ Use specified folder for testing
     targets = re.split(' |,', args.target)
 
     Test.ignore_comp_time_exp = args.ignore_comp_time_exp
+    yarpgen_args = []
+    if args.compact_driver:
+        yarpgen_args += ["--compact-driver=true"]
+    if args.gen_time_budget:
+        yarpgen_args += ["--max-gen-time=" + str(yarpgen_timeout)]
+    # IR takes only a part of the memory of the generator
+    if args.gen_mem_budget:
+        yarpgen_args += ["--max-gen-mem=" + str(yarpgen_mem_limit // 1024 // 4)]
+    if args.max_dyn_ops:
+        yarpgen_args += ["--max-dyn-ops=" + str(args.max_dyn_ops)]
+    if args.max_compile_cost:
+        yarpgen_args += ["--max-compile-cost=" + str(args.max_compile_cost)]
     prepare_env_and_start_testing(os.path.abspath(args.out_dir), args.timeout, targets, args.num_jobs,
                                   args.config_file, args.seeds_option_value, args.blame, args.creduce,
-                                  args.no_tmp_cleaner, args.collect_stat)
+                                  args.no_tmp_cleaner, args.collect_stat, args.shared_driver, yarpgen_args)
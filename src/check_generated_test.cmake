@@ -0,0 +1,48 @@
+###############################################################################
+#
+# Copyright (c) 2019-2020, Intel Corporation
+# Copyright (c) 2019-2020, University of Utah
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###############################################################################
+
+# Generates a test, builds it and runs it. The test has to pass its own check.
+# Usage: cmake -DYARPGEN=<bin> -DCOMPILER=<bin> -DOUT_DIR=<dir> -DSEED=<num>
+#              -DARGS=<generator options> -P check_generated_test.cmake
+
+file(REMOVE_RECURSE ${OUT_DIR})
+file(MAKE_DIRECTORY ${OUT_DIR})
+
+separate_arguments(ARGS)
+execute_process(COMMAND ${YARPGEN} -s ${SEED} -o ${OUT_DIR} ${ARGS}
+                RESULT_VARIABLE RES
+                OUTPUT_QUIET)
+if(NOT RES EQUAL 0)
+    message(FATAL_ERROR "Generator failed for seed ${SEED}: ${RES}")
+endif()
+
+file(GLOB SRCS ${OUT_DIR}/*.c ${OUT_DIR}/*.cpp)
+execute_process(COMMAND ${COMPILER} -w -O0 ${SRCS} -o ${OUT_DIR}/test
+                RESULT_VARIABLE RES)
+if(NOT RES EQUAL 0)
+    message(FATAL_ERROR "Build of seed ${SEED} failed: ${RES}")
+endif()
+
+execute_process(COMMAND ${OUT_DIR}/test
+                RESULT_VARIABLE RES
+                OUTPUT_VARIABLE OUT
+                ERROR_VARIABLE OUT)
+if(NOT RES EQUAL 0 OR OUT MATCHES "ERROR")
+    message(FATAL_ERROR "Seed ${SEED} failed: ${RES}\n${OUT}")
+endif()
@@ -45,6 +45,7 @@ PopulateCtx::PopulateCtx(std::shared_ptr<PopulateCtx> _par_ctx)
         in_stencil = par_ctx->in_stencil;
         mul_vals_iter = par_ctx->mul_vals_iter;
         allow_mul_vals = par_ctx->allow_mul_vals;
+        compile_cost_factor = par_ctx->compile_cost_factor;
     }
 }
 
@@ -60,6 +61,7 @@ PopulateCtx::PopulateCtx() {
     in_stencil = false;
     mul_vals_iter = nullptr;
     allow_mul_vals = false;
+    compile_cost_factor = 1;
 }
 
 size_t PopulateCtx::generateNumberOfDims(ArrayDimsUseKind dims_use_kind) const {
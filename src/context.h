@@ -211,6 +211,10 @@ class PopulateCtx : public GenCtx {
     void setAllowMulVals(bool _val) { allow_mul_vals = _val; }
     bool getAllowMulVals() { return allow_mul_vals; }
 
+    // Maximal code growth of the enclosing loops due to their pragmas
+    uint64_t getCompileCostFactor() { return compile_cost_factor; }
+    void setCompileCostFactor(uint64_t val) { compile_cost_factor = val; }
+
   private:
     std::shared_ptr<PopulateCtx> par_ctx;
     std::shared_ptr<SymbolTable> ext_inp_sym_tbl;
@@ -245,6 +249,8 @@ class PopulateCtx : public GenCtx {
     std::shared_ptr<Iterator> mul_vals_iter;
     // If we want to allow multiple values in this context
     bool allow_mul_vals;
+
+    uint64_t compile_cost_factor;
 };
 
 // TODO: maybe we need to inherit from some class
@@ -20,6 +20,7 @@ limitations under the License.
 #include "data.h"
 #include "context.h"
 #include "expr.h"
+#include "statistics.h"
 
 #include <utility>
 
@@ -40,7 +41,7 @@ std::shared_ptr<ScalarVar> ScalarVar::create(std::shared_ptr<PopulateCtx> ctx) {
     IRValue init_val = rand_val_gen->getRandValue(type_id);
     auto int_type = IntegralType::init(type_id);
     NameHandler &nh = NameHandler::getInstance();
-    return std::make_shared<ScalarVar>(nh.getVarName(), int_type, init_val);
+    return makeIRNode<ScalarVar>(nh.getVarName(), int_type, init_val);
 }
 
 std::string ScalarVar::getName(std::shared_ptr<EmitCtx> ctx) {
@@ -127,7 +128,7 @@ std::shared_ptr<Array> Array::create(std::shared_ptr<PopulateCtx> ctx,
     IRValue init_val = rand_val_gen->getRandValue(int_type->getIntTypeId());
     NameHandler &nh = NameHandler::getInstance();
     auto new_array =
-        std::make_shared<Array>(nh.getArrayName(), array_type, init_val);
+        makeIRNode<Array>(nh.getArrayName(), array_type, init_val);
 
     auto mul_vals =
         ctx->getMulValsIter() != nullptr &&
@@ -138,6 +139,14 @@ std::shared_ptr<Array> Array::create(std::shared_ptr<PopulateCtx> ctx,
     // it
     mul_vals |= !inp && ctx->getMulValsIter() != nullptr;
 
+    // The driver initializes and checks each element of the array
+    uint64_t elems_num = 1;
+    for (auto dim : array_type->getDimensions())
+        elems_num *= dim;
+    Statistics &stats = Statistics::getInstance();
+    stats.addDynOps(2 * elems_num);
+    stats.addCompileCost(ARRAY_COMPILE_COST);
+
     if (mul_vals) {
         init_val = rand_val_gen->getRandValue(int_type->getIntTypeId());
         auto mul_val_idx = static_cast<int64_t>(rand_val_gen->getRandValue(
@@ -197,7 +206,7 @@ std::shared_ptr<Iterator> Iterator::create(std::shared_ptr<PopulateCtx> ctx,
         left_span = 0;
 
     auto start =
-        std::make_shared<ConstantExpr>(IRValue{type_id, {false, left_span}});
+        makeIRNode<ConstantExpr>(IRValue{type_id, {false, left_span}});
 
     size_t end_val = _end_val;
     // We can't go pass the maximal value of the type
@@ -219,7 +228,7 @@ std::shared_ptr<Iterator> Iterator::create(std::shared_ptr<PopulateCtx> ctx,
     }
 
     auto end =
-        std::make_shared<ConstantExpr>(IRValue(type_id, {false, end_val}));
+        makeIRNode<ConstantExpr>(IRValue(type_id, {false, end_val}));
 
     size_t step_val = rand_val_gen->getRandId(gen_pol->iters_step_distr);
     if (!is_uniform)
@@ -230,21 +239,23 @@ std::shared_ptr<Iterator> Iterator::create(std::shared_ptr<PopulateCtx> ctx,
         int_type->getMax().getAbsValue().value)
         step_val = 1;
     auto step =
-        std::make_shared<ConstantExpr>(IRValue{type_id, {false, step_val}});
+        makeIRNode<ConstantExpr>(IRValue{type_id, {false, step_val}});
 
     size_t total_iters_num = (end_val - left_span + step_val - 1) / step_val;
 
     NameHandler &nh = NameHandler::getInstance();
-    auto iter = std::make_shared<Iterator>(
+    auto iter = makeIRNode<Iterator>(
         nh.getIterName(), type, start, left_span, end, right_span, step,
         end_val == left_span, total_iters_num);
 
-    bool supports_mul_vals = step_val % 2 != Options::main_val_idx ||
-                             left_span % 2 != Options::main_val_idx;
+    size_t vals_number = Options::getInstance().getValsNumber();
+    bool supports_mul_vals = step_val % vals_number != Options::main_val_idx ||
+                             left_span % vals_number != Options::main_val_idx;
     if (supports_mul_vals) {
         iter->setSupportsMulValues(supports_mul_vals);
         size_t last_val = (total_iters_num - 1) * step_val + left_span;
-        iter->setMainValsOnLastIter(last_val % 2 == Options::main_val_idx);
+        iter->setMainValsOnLastIter(last_val % vals_number ==
+                                    Options::main_val_idx);
     }
 
     return iter;
@@ -254,9 +265,11 @@ void Iterator::dbgDump() {
     std::cout << name << std::endl;
     type->dbgDump();
     auto emit_ctx = std::make_shared<EmitCtx>();
-    start->emit(emit_ctx, std::cout);
-    end->emit(emit_ctx, std::cout);
-    end->emit(emit_ctx, std::cout);
+    EmitStream stream;
+    start->emit(emit_ctx, stream);
+    end->emit(emit_ctx, stream);
+    end->emit(emit_ctx, stream);
+    std::cout << stream.str();
 }
 
 // This function bring the value of an expression that used in iterator
@@ -281,7 +294,7 @@ static std::shared_ptr<Expr> adjustIterExprValue(std::shared_ptr<Expr> expr,
     Options &options = Options::getInstance();
     if (options.isISPC())
         if (!eval_res->getType()->isUniform()) {
-            auto tmp = std::make_shared<ExtractCall>(expr);
+            auto tmp = makeIRNode<ExtractCall>(expr);
             tmp->setIsImplicit(true);
             expr = tmp;
         }
@@ -289,7 +302,7 @@ static std::shared_ptr<Expr> adjustIterExprValue(std::shared_ptr<Expr> expr,
     // Every binary operation applies integral promotion first, so we need to
     // guarantee that expression can be processed
     if (int_type->getIntTypeId() < IntTypeID::INT) {
-        expr = std::make_shared<TypeCastExpr>(
+        expr = makeIRNode<TypeCastExpr>(
             expr, IntegralType::init(IntTypeID::INT), true);
         value = value.castToType(IntTypeID::INT);
     }
@@ -317,11 +330,11 @@ static std::shared_ptr<Expr> adjustIterExprValue(std::shared_ptr<Expr> expr,
             break;
 
         if ((value > expr_val).getValueRef<bool>())
-            ret = std::make_shared<BinaryExpr>(
-                BinaryOp::ADD, ret, std::make_shared<ConstantExpr>(diff));
+            ret = makeIRNode<BinaryExpr>(
+                BinaryOp::ADD, ret, makeIRNode<ConstantExpr>(diff));
         else
-            ret = std::make_shared<BinaryExpr>(
-                BinaryOp::SUB, ret, std::make_shared<ConstantExpr>(diff));
+            ret = makeIRNode<BinaryExpr>(
+                BinaryOp::SUB, ret, makeIRNode<ConstantExpr>(diff));
     } while (true);
 
     return ret;
@@ -384,14 +397,14 @@ void Iterator::populate(std::shared_ptr<PopulateCtx> ctx) {
 
         if (options.isISPC())
             if (!ret_eval_res->getType()->isUniform()) {
-                ret = std::make_shared<ExtractCall>(ret);
+                ret = makeIRNode<ExtractCall>(ret);
                 ret_eval_res = ret->rebuild(eval_ctx);
                 int_eval_res_type = std::static_pointer_cast<IntegralType>(
                     ret_eval_res->getType());
             }
 
         if (int_type->getIntTypeId() != int_eval_res_type->getIntTypeId()) {
-            ret = std::make_shared<TypeCastExpr>(
+            ret = makeIRNode<TypeCastExpr>(
                 ret, IntegralType::init(int_type->getIntTypeId()), true);
             ret_eval_res = ret->rebuild(eval_ctx);
         }
@@ -22,6 +22,7 @@ limitations under the License.
 #include "enums.h"
 #include "ir_value.h"
 #include "options.h"
+#include "session.h"
 #include "type.h"
 #include <array>
 #include <deque>
@@ -68,7 +69,7 @@ class Data {
 
   protected:
     template <typename T> static std::shared_ptr<Data> makeVaryingImpl(T val) {
-        auto ret = std::make_shared<T>(val);
+        auto ret = makeIRNode<T>(val);
         ret->type = ret->getType()->makeVarying();
         return ret;
     }
@@ -186,8 +187,8 @@ class Array : public Data {
 
     // Span of initialization value can always be determined from array
     // dimensions and current value span
-    std::array<IRValue, Options::vals_number> init_vals;
-    std::array<IRValue, Options::vals_number> cur_vals;
+    std::array<IRValue, Options::val_kinds_num> init_vals;
+    std::array<IRValue, Options::val_kinds_num> cur_vals;
     // We use int64_t to use negative values as poison values that
     // indicate that the values are uniform
     int64_t mul_vals_axis_idx;
@@ -27,10 +27,10 @@ class EmitPolicy {
   public:
     EmitPolicy();
 
-    std::vector<Probability<bool>> asserts_check_distr;
-    std::vector<Probability<bool>> pass_as_param_distr;
-    std::vector<Probability<bool>> emit_align_attr_distr;
-    std::vector<Probability<AlignmentSize>> align_size_distr;
+    ProbDistr<bool> asserts_check_distr;
+    ProbDistr<bool> pass_as_param_distr;
+    ProbDistr<bool> emit_align_attr_distr;
+    ProbDistr<AlignmentSize> align_size_distr;
 };
 
 } // namespace yarpgen
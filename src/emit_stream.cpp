@@ -0,0 +1,35 @@
+/*
+Copyright (c) 2019-2020, Intel Corporation
+Copyright (c) 2019-2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+#include "emit_stream.h"
+#include "utils.h"
+
+#include <fstream>
+
+using namespace yarpgen;
+
+void EmitStream::writeToFile(const std::string &file_name) {
+    std::ofstream out_file(file_name, std::ios::binary);
+    if (!out_file)
+        ERROR(std::string("Can't open file ") + file_name);
+    out_file.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    if (!out_file)
+        ERROR(std::string("Can't write file ") + file_name);
+    buf.clear();
+}
@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2019-2020, Intel Corporation
+Copyright (c) 2019-2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace yarpgen {
+
+// Output stream for the emission of the test. The text of the file is
+// accumulated in the buffer and then written to the file at once, so we
+// don't pay for the formatting machinery of std::ostream on every fragment.
+// The buffer keeps its capacity after the file is written, so it can be reused
+// for the next file.
+class EmitStream {
+  public:
+    // Width of one level of indentation
+    static constexpr size_t INDENT_WIDTH = 4;
+
+    EmitStream &operator<<(std::string_view str) {
+        buf.append(str);
+        return *this;
+    }
+    EmitStream &operator<<(const std::string &str) {
+        buf.append(str);
+        return *this;
+    }
+    EmitStream &operator<<(const char *str) {
+        buf.append(str);
+        return *this;
+    }
+    EmitStream &operator<<(char c) {
+        buf.push_back(c);
+        return *this;
+    }
+    // Integers (and bool) are printed as decimal numbers
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value &&
+                                !std::is_same<T, char>::value,
+                            EmitStream &>::type
+    operator<<(T val) {
+        char num_buf[24];
+        auto res = std::to_chars(num_buf, num_buf + sizeof(num_buf),
+                                 static_cast<typename std::conditional<
+                                     std::is_signed<T>::value, long long,
+                                     unsigned long long>::type>(val));
+        buf.append(num_buf, res.ptr);
+        return *this;
+    }
+
+    // Emits the indentation of the given depth
+    EmitStream &indent(size_t depth) {
+        buf.append(depth * INDENT_WIDTH, ' ');
+        return *this;
+    }
+
+    const std::string &str() const { return buf; }
+    // Writes the accumulated text to the file and clears the buffer
+    void writeToFile(const std::string &file_name);
+
+  private:
+    std::string buf;
+};
+} // namespace yarpgen
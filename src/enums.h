@@ -163,6 +163,17 @@ enum class OptionKind {
     MUTATE,
     MUTATION_SEED,
     UB_IN_DC,
+    BATCH,
+    JOBS,
+    SEED_VERSION,
+    COMPACT_DRIVER,
+    STATS,
+    MAX_GEN_TIME,
+    BUDGET_TRIP_POINT,
+    MAX_GEN_MEM,
+    MAX_DYN_OPS,
+    MAX_COMPILE_COST,
+    VALS_NUMBER,
     MAX_OPTION_ID
 };
 
@@ -212,7 +223,34 @@ enum class SpecialConst {
     MAX_SPECIAL_CONST
 };
 
-enum class CheckAlgo { HASH, ASSERTS, PRECOMPUTE, MAX_CHECK_ALGO };
+// LANES_* algorithms hash each array over its memory with several independent
+// lanes, which are folded into the seed at the end. It breaks the dependency
+// chain of the serial hash, so the check is much faster for large arrays.
+enum class CheckAlgo {
+    HASH,
+    ASSERTS,
+    PRECOMPUTE,
+    LANES_HASH,
+    LANES_PRECOMPUTE,
+    MAX_CHECK_ALGO
+};
+
+// Version of the algorithms that are used for random choices. The same seed
+// produces the same test only with the same version.
+// V1 - sampling with std::discrete_distribution
+// V2 - sampling with integer alias tables, reductions in iteration spaces of
+//      any size
+enum class SeedVersion { V1, V2, MAX_SEED_VERSION };
+
+// Phases of the generation that are timed for the statistics
+enum class GenPhase {
+    GEN_STRUCTURE,
+    POPULATE,
+    PROPAGATE_TYPE,
+    REBUILD,
+    EMIT,
+    MAX_GEN_PHASE
+};
 
 enum class MutationKind { NONE, EXPRS, ALL, MAX_MUTATION_FIND };
 
@@ -20,6 +20,7 @@ limitations under the License.
 #include "expr.h"
 #include "context.h"
 #include "options.h"
+#include "session.h"
 #include <algorithm>
 #include <deque>
 #include <numeric>
@@ -27,12 +28,6 @@ limitations under the License.
 
 using namespace yarpgen;
 
-std::unordered_map<std::shared_ptr<Data>, std::shared_ptr<ScalarVarUseExpr>>
-    yarpgen::ScalarVarUseExpr::scalar_var_use_set;
-std::unordered_map<std::shared_ptr<Data>, std::shared_ptr<ArrayUseExpr>>
-    yarpgen::ArrayUseExpr::array_use_set;
-std::unordered_map<std::shared_ptr<Data>, std::shared_ptr<IterUseExpr>>
-    yarpgen::IterUseExpr::iter_use_set;
 
 static std::shared_ptr<Data>
 replaceValueWith(std::shared_ptr<Data> &_value,
@@ -48,12 +43,40 @@ std::shared_ptr<Data> Expr::getValue() {
     return value;
 }
 
-std::vector<std::shared_ptr<ConstantExpr>> yarpgen::ConstantExpr::used_consts;
+thread_local uint64_t Expr::eval_epoch = 1;
+
+bool Expr::lookupEvalResult(EvalCtx &ctx) {
+    // Leaf nodes can be substituted with the input, so we can't memoize
+    if (!ctx.input.empty())
+        return false;
+    EvalResult &res = eval_results[ctx.use_main_vals];
+    if (res.epoch != eval_epoch)
+        return false;
+    value = res.value;
+    return true;
+}
+
+void Expr::storeEvalResult(EvalCtx &ctx) {
+    if (!ctx.input.empty())
+        return;
+    EvalResult &res = eval_results[ctx.use_main_vals];
+    res.epoch = eval_epoch;
+    res.value = value;
+}
+
+void Expr::invalidate() {
+    type_propagated = false;
+    for (auto &res : eval_results) {
+        res.epoch = 0;
+        res.value = nullptr;
+    }
+}
+
 
 ConstantExpr::ConstantExpr(IRValue _value) {
     // TODO: maybe we need a constant data type rather than an anonymous scalar
     // variable
-    value = std::make_shared<ScalarVar>(
+    value = makeIRNode<ScalarVar>(
         "", IntegralType::init(_value.getIntTypeID()), _value);
 }
 
@@ -61,8 +84,8 @@ Expr::EvalResType ConstantExpr::evaluate(EvalCtx &ctx) { return value; }
 
 Expr::EvalResType ConstantExpr::rebuild(EvalCtx &ctx) { return evaluate(ctx); }
 
-void ConstantExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                        std::string offset) {
+void ConstantExpr::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                        size_t offset) {
     assert(value->isScalarVar() &&
            "ConstExpr can represent only scalar constant");
     auto scalar_var = std::static_pointer_cast<ScalarVar>(value);
@@ -102,6 +125,7 @@ void ConstantExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 std::shared_ptr<ConstantExpr>
 ConstantExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     auto gen_pol = ctx->getGenPolicy();
+    auto &used_consts = GenSession::getCurrent().getUsedConsts();
     bool reuse_const = rand_val_gen->getRandId(gen_pol->reuse_const_prob);
     std::shared_ptr<ConstantExpr> ret;
     bool can_add_to_buf = true;
@@ -147,7 +171,7 @@ ConstantExpr::create(std::shared_ptr<PopulateCtx> ctx) {
             if (type_id < IntTypeID::INT)
                 ir_val = ir_val.castToType(type_id);
 
-            ret = std::make_shared<ConstantExpr>(ir_val);
+            ret = makeIRNode<ConstantExpr>(ir_val);
         }
     }
     else {
@@ -205,7 +229,7 @@ ConstantExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         else
             init_val = rand_val_gen->getRandValue(type_id);
 
-        ret = std::make_shared<ConstantExpr>(init_val);
+        ret = makeIRNode<ConstantExpr>(init_val);
     }
 
     bool use_offset = rand_val_gen->getRandId(gen_pol->use_const_offset_distr);
@@ -240,7 +264,7 @@ ConstantExpr::create(std::shared_ptr<PopulateCtx> ctx) {
             ir_val = ir_val.castToType(type_id);
 
         if (!ir_val.hasUB()) {
-            ret = std::make_shared<ConstantExpr>(ir_val);
+            ret = makeIRNode<ConstantExpr>(ir_val);
             can_add_to_buf = true;
         }
     }
@@ -262,20 +286,18 @@ ConstantExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     return ret;
 }
 
-std::shared_ptr<Expr> ConstantExpr::copy() {
-    return std::make_shared<ConstantExpr>(
-        std::static_pointer_cast<ScalarVar>(value)->getCurrentValue());
-}
+std::shared_ptr<Expr> ConstantExpr::copy() { return shared_from_this(); }
 
 std::shared_ptr<ScalarVarUseExpr>
 ScalarVarUseExpr::init(std::shared_ptr<Data> _val) {
     assert(_val->isScalarVar() &&
            "ScalarVarUseExpr accepts only scalar variables!");
+    auto &scalar_var_use_set = GenSession::getCurrent().getScalarVarUseSet();
     auto find_res = scalar_var_use_set.find(_val);
     if (find_res != scalar_var_use_set.end())
         return find_res->second;
 
-    auto ret = std::make_shared<ScalarVarUseExpr>(_val);
+    auto ret = makeIRNode<ScalarVarUseExpr>(_val);
     scalar_var_use_set[_val] = ret;
     return ret;
 }
@@ -288,10 +310,13 @@ void ScalarVarUseExpr::setValue(std::shared_ptr<Expr> _expr) {
 
     std::static_pointer_cast<ScalarVar>(value)->setCurrentValue(
         std::static_pointer_cast<ScalarVar>(new_val)->getCurrentValue());
+    invalidateEvalResults();
 }
 
 Expr::EvalResType ScalarVarUseExpr::evaluate(EvalCtx &ctx) {
     // This variable is defined, and we can just return it.
+    if (ctx.input.empty())
+        return value;
     auto find_res = ctx.input.find(value->getName(EmitCtx::default_emit_ctx));
     if (find_res != ctx.input.end())
         value = find_res->second;
@@ -308,18 +333,17 @@ ScalarVarUseExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     return rand_val_gen->getRandElem(avail_vars);
 }
 
-std::shared_ptr<Expr> ScalarVarUseExpr::copy() {
-    return std::make_shared<ScalarVarUseExpr>(value);
-}
+std::shared_ptr<Expr> ScalarVarUseExpr::copy() { return shared_from_this(); }
 
 std::shared_ptr<ArrayUseExpr> ArrayUseExpr::init(std::shared_ptr<Data> _val) {
     assert(_val->isArray() &&
            "ArrayUseExpr can be initialized only with Arrays");
+    auto &array_use_set = GenSession::getCurrent().getArrayUseSet();
     auto find_res = array_use_set.find(_val);
     if (find_res != array_use_set.end())
         return find_res->second;
 
-    auto ret = std::make_shared<ArrayUseExpr>(_val);
+    auto ret = makeIRNode<ArrayUseExpr>(_val);
     array_use_set[_val] = ret;
     return ret;
 }
@@ -339,10 +363,13 @@ void ArrayUseExpr::setValue(std::shared_ptr<Expr> _expr, bool main_val) {
     auto expr_scalar_var =
         std::static_pointer_cast<ScalarVar>(_expr->getValue());
     arr_val->setCurrentValue(expr_scalar_var->getCurrentValue(), main_val);
+    invalidateEvalResults();
 }
 
 Expr::EvalResType ArrayUseExpr::evaluate(EvalCtx &ctx) {
     // This array is defined, and we can just return it.
+    if (ctx.input.empty())
+        return value;
     auto find_res = ctx.input.find(value->getName(EmitCtx::default_emit_ctx));
     if (find_res != ctx.input.end())
         value = find_res->second;
@@ -352,17 +379,16 @@ Expr::EvalResType ArrayUseExpr::evaluate(EvalCtx &ctx) {
 
 Expr::EvalResType ArrayUseExpr::rebuild(EvalCtx &ctx) { return evaluate(ctx); }
 
-std::shared_ptr<Expr> ArrayUseExpr::copy() {
-    return std::make_shared<ArrayUseExpr>(value);
-}
+std::shared_ptr<Expr> ArrayUseExpr::copy() { return shared_from_this(); }
 
 std::shared_ptr<IterUseExpr> IterUseExpr::init(std::shared_ptr<Data> _iter) {
     assert(_iter->isIterator() && "IterUseExpr accepts only iterators!");
+    auto &iter_use_set = GenSession::getCurrent().getIterUseSet();
     auto find_res = iter_use_set.find(_iter);
     if (find_res != iter_use_set.end())
         return find_res->second;
 
-    auto ret = std::make_shared<IterUseExpr>(_iter);
+    auto ret = makeIRNode<IterUseExpr>(_iter);
     iter_use_set[_iter] = ret;
     return ret;
 }
@@ -376,10 +402,13 @@ void IterUseExpr::setValue(std::shared_ptr<Expr> _expr) {
 
     std::static_pointer_cast<Iterator>(value)->setParameters(
         new_iter->getStart(), new_iter->getEnd(), new_iter->getStep());
+    invalidateEvalResults();
 }
 
 Expr::EvalResType IterUseExpr::evaluate(EvalCtx &ctx) {
     // This iterator is defined, and we can just return it.
+    if (ctx.input.empty())
+        return value;
     auto find_res = ctx.input.find(value->getName(EmitCtx::default_emit_ctx));
     if (find_res != ctx.input.end())
         value = find_res->second;
@@ -388,32 +417,103 @@ Expr::EvalResType IterUseExpr::evaluate(EvalCtx &ctx) {
 
 Expr::EvalResType IterUseExpr::rebuild(EvalCtx &ctx) { return evaluate(ctx); }
 
-std::shared_ptr<Expr> IterUseExpr::copy() {
-    return std::make_shared<IterUseExpr>(value);
+std::shared_ptr<Expr> IterUseExpr::copy() { return shared_from_this(); }
+
+std::shared_ptr<Type> Operand::getType() {
+    if (implicit_convs.empty())
+        return expr->getValue()->getType();
+    return implicit_convs.back();
+}
+
+std::shared_ptr<Data> Operand::getValue() {
+    if (implicit_convs.empty())
+        return expr->getValue();
+    return value;
+}
+
+void Operand::addImplicitConv(const std::shared_ptr<Type> &to_type) {
+    assert(to_type->isIntType() && "We can cast only integral types for now");
+    implicit_convs.push_back(std::static_pointer_cast<IntegralType>(to_type));
+    value = nullptr;
+    Statistics::getInstance().addImplicitConv();
+}
+
+Expr::EvalResType Operand::evaluate(EvalCtx &ctx) {
+    Expr::EvalResType expr_eval_res = expr->evaluate(ctx);
+    if (implicit_convs.empty())
+        return expr_eval_res;
+
+    std::shared_ptr<Type> base_type = expr_eval_res->getType();
+    if (!base_type->isIntType() || !expr_eval_res->isScalarVar())
+        ERROR("We can cast only integer scalar variables for now");
+
+    Options &options = Options::getInstance();
+    IRValue val =
+        std::static_pointer_cast<ScalarVar>(expr_eval_res)->getCurrentValue();
+    for (const auto &to_int_type : implicit_convs) {
+        if (options.isISPC() && to_int_type->isUniform() &&
+            !base_type->isUniform())
+            ERROR("Can't cast varying to uniform");
+        val = val.castToType(to_int_type->getIntTypeId());
+        base_type = to_int_type;
+    }
+
+    auto to_int_type = implicit_convs.back();
+    auto scalar_val = makeIRNode<ScalarVar>(
+        "", to_int_type, IRValue(to_int_type->getIntTypeId()));
+    scalar_val->setCurrentValue(val);
+    value = scalar_val;
+    return value;
+}
+
+Expr::EvalResType Operand::rebuild(EvalCtx &ctx) {
+    expr->rebuild(ctx);
+    // The conversion between integral types can't cause UB by itself
+    return evaluate(ctx);
+}
+
+void Operand::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream) {
+    // The conversions are emitted in the same way as the implicit TypeCastExpr
+    for (auto iter = implicit_convs.rbegin(); iter != implicit_convs.rend();
+         ++iter)
+        stream << "((/* implicit */" << (*iter)->getName(ctx) << ") ";
+    expr->emit(ctx, stream);
+    for (size_t i = 0; i < implicit_convs.size(); ++i)
+        stream << ")";
 }
 
-TypeCastExpr::TypeCastExpr(std::shared_ptr<Expr> _expr,
-                           std::shared_ptr<Type> _to_type, bool _is_implicit)
+Operand Operand::copy() {
+    Operand ret(expr->copy());
+    ret.implicit_convs = implicit_convs;
+    return ret;
+}
+
+TypeCastExpr::TypeCastExpr(Operand _expr, std::shared_ptr<Type> _to_type,
+                           bool _is_implicit)
     : expr(std::move(_expr)), to_type(std::move(_to_type)),
       is_implicit(_is_implicit) {
     assert(to_type->isIntType() && "We can cast only integral types for now");
     auto to_int_type = std::static_pointer_cast<IntegralType>(to_type);
     if (!to_type->isUniform())
         to_int_type->makeVarying();
-    value = std::make_shared<TypedData>(to_int_type);
+    value = makeIRNode<TypedData>(to_int_type);
 }
 
 bool TypeCastExpr::propagateType() {
-    expr->propagateType();
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
+    expr.propagateType();
+    setTypePropagated();
     return true;
 }
 
-void TypeCastExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                        std::string offset) {
+void TypeCastExpr::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                        size_t offset) {
     // TODO: add switch for C++ style conversions and switch for implicit casts
     stream << "((" << (is_implicit ? "/* implicit */" : "")
            << to_type->getName(ctx) << ") ";
-    expr->emit(ctx, stream);
+    expr.emit(ctx, stream);
     stream << ")";
 }
 
@@ -432,13 +532,15 @@ TypeCastExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         is_uniform = expr_val->getType()->isUniform();
     }
 
-    return std::make_shared<TypeCastExpr>(
+    return makeIRNode<TypeCastExpr>(
         expr, IntegralType::init(to_type, false, CVQualifier::NONE, is_uniform),
         /*is_implicit*/ false);
 }
 
 Expr::EvalResType TypeCastExpr::evaluate(EvalCtx &ctx) {
-    EvalResType expr_eval_res = expr->evaluate(ctx);
+    if (lookupEvalResult(ctx))
+        return value;
+    EvalResType expr_eval_res = expr.evaluate(ctx);
     std::shared_ptr<Type> base_type = expr_eval_res->getType();
     // Check that we try to convert between compatible types.
     if (!((base_type->isIntType() && to_type->isIntType()) ||
@@ -449,7 +551,7 @@ Expr::EvalResType TypeCastExpr::evaluate(EvalCtx &ctx) {
     if (base_type->isIntType() && expr_eval_res->isScalarVar()) {
         std::shared_ptr<IntegralType> to_int_type =
             std::static_pointer_cast<IntegralType>(to_type);
-        auto scalar_val = std::make_shared<ScalarVar>(
+        auto scalar_val = makeIRNode<ScalarVar>(
             "", to_int_type, IRValue(to_int_type->getIntTypeId()));
         std::shared_ptr<ScalarVar> base_scalar_var =
             std::static_pointer_cast<ScalarVar>(expr_eval_res);
@@ -468,88 +570,71 @@ Expr::EvalResType TypeCastExpr::evaluate(EvalCtx &ctx) {
         // TODO: extend it
         ERROR("We can cast only integer scalar variables for now");
     }
+    storeEvalResult(ctx);
     return value;
 }
 
 Expr::EvalResType TypeCastExpr::rebuild(EvalCtx &ctx) {
+    invalidate();
     propagateType();
-    expr->rebuild(ctx);
+    expr.rebuild(ctx);
     std::shared_ptr<Data> eval_res = evaluate(ctx);
     assert(eval_res->getKind() == DataKind::VAR &&
            "Type Cast operations are only supported for Scalar Variables");
 
-    auto eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
-    if (!eval_scalar_res->getCurrentValue().hasUB()) {
-        value = eval_res;
-        return eval_res;
-    }
-
-    do {
-        eval_res = evaluate(ctx);
-        eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
-        if (!eval_scalar_res->getCurrentValue().hasUB())
-            break;
-        rebuild(ctx);
-    } while (eval_scalar_res->getCurrentValue().hasUB());
-
+    // The conversion between integral types can't cause UB by itself
+    assert(!std::static_pointer_cast<ScalarVar>(eval_res)
+                ->getCurrentValue()
+                .hasUB() &&
+           "Type cast of the value without UB can't cause UB");
     value = eval_res;
-    return value;
+    return eval_res;
 }
 
 std::shared_ptr<Expr> TypeCastExpr::copy() {
-    auto new_expr = expr->copy();
-    return std::make_shared<TypeCastExpr>(new_expr, to_type, is_implicit);
+    auto new_expr = expr.copy();
+    return makeIRNode<TypeCastExpr>(new_expr, to_type, is_implicit);
 }
 
-std::shared_ptr<Expr> ArithmeticExpr::integralProm(std::shared_ptr<Expr> arg) {
-    if (!arg->getValue()->isScalarVar() && !arg->getValue()->isTypedData()) {
+void ArithmeticExpr::integralProm(Operand &arg) {
+    auto arg_type = arg.getType();
+    if (!arg_type->isIntType()) {
         ERROR("Can perform integral promotion only on scalar variables");
     }
 
     // C++ draft N4713: 7.6 Integral promotions [conv.prom]
-    assert(arg->getValue()->getType()->isIntType() &&
-           "Scalar variable can have only Integral Type");
     std::shared_ptr<IntegralType> int_type =
-        std::static_pointer_cast<IntegralType>(arg->getValue()->getType());
+        std::static_pointer_cast<IntegralType>(arg_type);
     if (int_type->getIntTypeId() >=
         IntTypeID::INT) // can't perform integral promotion
-        return arg;
+        return;
     // TODO: we need to check if type fits in int or unsigned int
-    return std::make_shared<TypeCastExpr>(
-        arg,
-        IntegralType::init(IntTypeID::INT, false, CVQualifier::NONE,
-                           arg->getValue()->getType()->isUniform()),
-        true);
+    arg.addImplicitConv(IntegralType::init(
+        IntTypeID::INT, false, CVQualifier::NONE, arg_type->isUniform()));
 }
 
-std::shared_ptr<Expr> ArithmeticExpr::convToBool(std::shared_ptr<Expr> arg) {
-    if (!arg->getValue()->isScalarVar() && !arg->getValue()->isTypedData()) {
+void ArithmeticExpr::convToBool(Operand &arg) {
+    auto arg_type = arg.getType();
+    if (!arg_type->isIntType()) {
         ERROR("Can perform conversion to bool only on scalar variables");
     }
 
     std::shared_ptr<IntegralType> int_type =
-        std::static_pointer_cast<IntegralType>(arg->getValue()->getType());
+        std::static_pointer_cast<IntegralType>(arg_type);
     if (int_type->getIntTypeId() == IntTypeID::BOOL)
-        return arg;
-    return std::make_shared<TypeCastExpr>(
-        arg,
-        IntegralType::init(IntTypeID::BOOL, false, CVQualifier::NONE,
-                           arg->getValue()->getType()->isUniform()),
-        true);
-}
-
-void ArithmeticExpr::arithConv(std::shared_ptr<Expr> &lhs,
-                               std::shared_ptr<Expr> &rhs) {
-    if (!lhs->getValue()->getType()->isIntType() ||
-        !rhs->getValue()->getType()->isIntType()) {
+        return;
+    arg.addImplicitConv(IntegralType::init(
+        IntTypeID::BOOL, false, CVQualifier::NONE, arg_type->isUniform()));
+}
+
+void ArithmeticExpr::arithConv(Operand &lhs, Operand &rhs) {
+    if (!lhs.getType()->isIntType() || !rhs.getType()->isIntType()) {
         ERROR("We assume that we can perform binary operations only in Scalar "
               "Variables with integral type");
     }
 
-    auto lhs_type =
-        std::static_pointer_cast<IntegralType>(lhs->getValue()->getType());
-    auto rhs_type =
-        std::static_pointer_cast<IntegralType>(rhs->getValue()->getType());
+    auto lhs_type = std::static_pointer_cast<IntegralType>(lhs.getType());
+    auto rhs_type = std::static_pointer_cast<IntegralType>(rhs.getType());
 
     // C++ draft N4713: 8.3 Usual arithmetic conversions [expr.arith.conv]
     // 1.5.1
@@ -562,11 +647,9 @@ void ArithmeticExpr::arithConv(std::shared_ptr<Expr> &lhs,
             lhs_type->getIntTypeId() > rhs_type->getIntTypeId() ? lhs_type
                                                                 : rhs_type;
         if (lhs_type->getIntTypeId() > rhs_type->getIntTypeId())
-            rhs = std::make_shared<TypeCastExpr>(rhs, max_type,
-                                                 /*is_implicit*/ true);
+            rhs.addImplicitConv(max_type);
         else
-            lhs = std::make_shared<TypeCastExpr>(lhs, max_type,
-                                                 /*is_implicit*/ true);
+            lhs.addImplicitConv(max_type);
         return;
     }
 
@@ -574,11 +657,10 @@ void ArithmeticExpr::arithConv(std::shared_ptr<Expr> &lhs,
     // Helper function that converts signed type to "bigger" unsigned type
     auto signed_to_unsigned_conv = [](std::shared_ptr<IntegralType> &a_type,
                                       std::shared_ptr<IntegralType> &b_type,
-                                      std::shared_ptr<Expr> &b_expr) -> bool {
+                                      Operand &b_expr) -> bool {
         if (!a_type->getIsSigned() &&
             (a_type->getIntTypeId() >= b_type->getIntTypeId())) {
-            b_expr = std::make_shared<TypeCastExpr>(b_expr, a_type,
-                                                    /*is_implicit*/ true);
+            b_expr.addImplicitConv(a_type);
             return true;
         }
         return false;
@@ -591,12 +673,11 @@ void ArithmeticExpr::arithConv(std::shared_ptr<Expr> &lhs,
     // Same idea, but for unsigned to signed conversions
     auto unsigned_to_signed_conv = [](std::shared_ptr<IntegralType> &a_type,
                                       std::shared_ptr<IntegralType> &b_type,
-                                      std::shared_ptr<Expr> &b_expr) -> bool {
+                                      Operand &b_expr) -> bool {
         if (a_type->getIsSigned() &&
             IntegralType::canRepresentType(b_type->getIntTypeId(),
                                            a_type->getIntTypeId())) {
-            b_expr = std::make_shared<TypeCastExpr>(b_expr, a_type,
-                                                    /*is_implicit*/ true);
+            b_expr.addImplicitConv(a_type);
             return true;
         }
         return false;
@@ -607,18 +688,15 @@ void ArithmeticExpr::arithConv(std::shared_ptr<Expr> &lhs,
 
     // 1.5.5
     auto final_conversion = [](std::shared_ptr<IntegralType> &a_type,
-                               std::shared_ptr<Expr> &a_expr,
-                               std::shared_ptr<Expr> &b_expr) -> bool {
+                               Operand &a_expr, Operand &b_expr) -> bool {
         if (a_type->getIsSigned()) {
             std::shared_ptr<IntegralType> new_type = IntegralType::init(
                 IntegralType::getCorrUnsigned(a_type->getIntTypeId()));
             if (!a_type->isUniform())
                 new_type = std::static_pointer_cast<IntegralType>(
                     new_type->makeVarying());
-            a_expr = std::make_shared<TypeCastExpr>(a_expr, new_type,
-                                                    /*is_implicit*/ true);
-            b_expr = std::make_shared<TypeCastExpr>(b_expr, new_type,
-                                                    /*is_implicit*/ true);
+            a_expr.addImplicitConv(new_type);
+            b_expr.addImplicitConv(new_type);
             return true;
         }
         return false;
@@ -630,18 +708,15 @@ void ArithmeticExpr::arithConv(std::shared_ptr<Expr> &lhs,
     ERROR("Unreachable: conversions went wrong");
 }
 
-void ArithmeticExpr::varyingPromotion(std::shared_ptr<Expr> &lhs,
-                                      std::shared_ptr<Expr> &rhs) {
-    auto lhs_type = lhs->getValue()->getType();
-    auto rhs_type = rhs->getValue()->getType();
+void ArithmeticExpr::varyingPromotion(Operand &lhs, Operand &rhs) {
+    auto lhs_type = lhs.getType();
+    auto rhs_type = rhs.getType();
 
     auto varying_conversion = [](std::shared_ptr<Type> &a_type,
                                  std::shared_ptr<Type> &b_type,
-                                 std::shared_ptr<Expr> &b_expr) -> bool {
+                                 Operand &b_expr) -> bool {
         if (!a_type->isUniform() && b_type->isUniform()) {
-            auto new_type = b_type->makeVarying();
-            b_expr = std::make_shared<TypeCastExpr>(b_expr, new_type,
-                                                    /*is_implicit*/ true);
+            b_expr.addImplicitConv(b_type->makeVarying());
             return true;
         }
         return false;
@@ -1252,6 +1327,7 @@ std::shared_ptr<Expr> ArithmeticExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         // We normally generate UB in the first place and eliminate it later.
         // If we don't do anything to avoid it, we will get it for free
         if (!allow_ub) {
+            PhaseTimer timer(GenPhase::REBUILD);
             new_node->propagateType();
             EvalCtx eval_ctx;
             new_node->rebuild(eval_ctx);
@@ -1262,30 +1338,36 @@ std::shared_ptr<Expr> ArithmeticExpr::create(std::shared_ptr<PopulateCtx> ctx) {
 }
 
 bool UnaryExpr::propagateType() {
-    arg->propagateType();
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
+    arg.propagateType();
     switch (op) {
         case UnaryOp::PLUS:
         case UnaryOp::NEGATE:
         case UnaryOp::BIT_NOT:
-            arg = integralProm(arg);
+            integralProm(arg);
             break;
         case UnaryOp::LOG_NOT:
-            arg = convToBool(arg);
+            convToBool(arg);
             break;
         case UnaryOp::MAX_UN_OP:
             ERROR("Bad unary operator");
             break;
     }
-    value = std::make_shared<TypedData>(arg->getValue()->getType());
+    value = makeIRNode<TypedData>(arg.getType());
+    setTypePropagated();
     return true;
 }
 
 Expr::EvalResType UnaryExpr::evaluate(EvalCtx &ctx) {
+    if (lookupEvalResult(ctx))
+        return value;
     propagateType();
-    EvalResType eval_res = arg->evaluate(ctx);
+    EvalResType eval_res = arg.evaluate(ctx);
     assert(eval_res->getKind() == DataKind::VAR &&
            "Unary operations are supported for Scalar Variables only");
-    auto scalar_arg = std::static_pointer_cast<ScalarVar>(arg->getValue());
+    auto scalar_arg = std::static_pointer_cast<ScalarVar>(arg.getValue());
     IRValue new_val;
     switch (op) {
         case UnaryOp::PLUS:
@@ -1309,17 +1391,19 @@ Expr::EvalResType UnaryExpr::evaluate(EvalCtx &ctx) {
            "Types only");
     value = replaceValueWith(
         value,
-        std::make_shared<ScalarVar>(
+        makeIRNode<ScalarVar>(
             "",
             IntegralType::init(new_val.getIntTypeID(), false, CVQualifier::NONE,
-                               arg->getValue()->getType()->isUniform()),
+                               arg.getType()->isUniform()),
             new_val));
+    storeEvalResult(ctx);
     return value;
 }
 
 Expr::EvalResType UnaryExpr::rebuild(EvalCtx &ctx) {
+    invalidate();
     propagateType();
-    arg->rebuild(ctx);
+    arg.rebuild(ctx);
     EvalResType eval_res = evaluate(ctx);
     assert(eval_res->getKind() == DataKind::VAR &&
            "Unary operations are supported for Scalar Variables of Integral "
@@ -1330,28 +1414,29 @@ Expr::EvalResType UnaryExpr::rebuild(EvalCtx &ctx) {
         return value;
     }
 
+    // The argument is free of UB, so only the negation of the minimal value
+    // can cause it, and unary plus always fixes it
+    Statistics::getInstance().addUB(
+        eval_scalar_res->getCurrentValue().getUBCode());
     if (op == UnaryOp::NEGATE) {
         op = UnaryOp::PLUS;
     }
     else {
         ERROR("Something went wrong, this should be unreachable");
     }
+    invalidate();
 
-    do {
-        eval_res = evaluate(ctx);
-        eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
-        if (!eval_scalar_res->getCurrentValue().hasUB())
-            break;
-        rebuild(ctx);
-    } while (eval_scalar_res->getCurrentValue().hasUB());
-
-    value = eval_res;
+    value = evaluate(ctx);
+    assert(!std::static_pointer_cast<ScalarVar>(value)
+                ->getCurrentValue()
+                .hasUB() &&
+           "Unary plus can't cause UB");
     return value;
 }
 
-void UnaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                     std::string offset) {
-    stream << offset << "(";
+void UnaryExpr::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                     size_t offset) {
+    stream.indent(offset) << "(";
     switch (op) {
         case UnaryOp::PLUS:
             stream << "+";
@@ -1370,27 +1455,30 @@ void UnaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
             break;
     }
     stream << "(";
-    arg->emit(ctx, stream);
+    arg.emit(ctx, stream);
     stream << "))";
 }
 std::shared_ptr<UnaryExpr> UnaryExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     auto gen_pol = ctx->getGenPolicy();
     UnaryOp op = rand_val_gen->getRandId(gen_pol->unary_op_distr);
     auto expr = ArithmeticExpr::create(ctx);
-    return std::make_shared<UnaryExpr>(op, expr);
+    return makeIRNode<UnaryExpr>(op, expr);
 }
 
-UnaryExpr::UnaryExpr(UnaryOp _op, std::shared_ptr<Expr> _expr)
+UnaryExpr::UnaryExpr(UnaryOp _op, Operand _expr)
     : op(_op), arg(std::move(_expr)) {}
 
 std::shared_ptr<Expr> UnaryExpr::copy() {
-    auto new_arg = arg->copy();
-    return std::make_shared<UnaryExpr>(op, new_arg);
+    auto new_arg = arg.copy();
+    return makeIRNode<UnaryExpr>(op, new_arg);
 }
 
 bool BinaryExpr::propagateType() {
-    lhs->propagateType();
-    rhs->propagateType();
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
+    lhs.propagateType();
+    rhs.propagateType();
 
     Options &options = Options::getInstance();
     if (options.isISPC())
@@ -1412,19 +1500,19 @@ bool BinaryExpr::propagateType() {
         case BinaryOp::BIT_OR:
         case BinaryOp::BIT_XOR:
             // Arithmetic conversions
-            lhs = integralProm(lhs);
-            rhs = integralProm(rhs);
+            integralProm(lhs);
+            integralProm(rhs);
             arithConv(lhs, rhs);
             break;
         case BinaryOp::SHL:
         case BinaryOp::SHR:
-            lhs = integralProm(lhs);
-            rhs = integralProm(rhs);
+            integralProm(lhs);
+            integralProm(rhs);
             break;
         case BinaryOp::LOG_AND:
         case BinaryOp::LOG_OR:
-            lhs = convToBool(lhs);
-            rhs = convToBool(rhs);
+            convToBool(lhs);
+            convToBool(rhs);
             break;
         case BinaryOp::MAX_BIN_OP:
             ERROR("Bad operation code");
@@ -1435,19 +1523,21 @@ bool BinaryExpr::propagateType() {
                           op == BinaryOp::LE || op == BinaryOp::GE ||
                           op == BinaryOp::EQ || op == BinaryOp::NE;
     auto bool_type = IntegralType::init(IntTypeID::BOOL);
-    if (options.isISPC() && !lhs->getValue()->getType()->isUniform())
+    if (options.isISPC() && !lhs.getType()->isUniform())
         bool_type =
             std::static_pointer_cast<IntegralType>(bool_type->makeVarying());
-    value = std::make_shared<TypedData>(
-        result_is_bool ? bool_type : lhs->getValue()->getType());
+    value = makeIRNode<TypedData>(result_is_bool ? bool_type : lhs.getType());
 
+    setTypePropagated();
     return true;
 }
 
 Expr::EvalResType BinaryExpr::evaluate(EvalCtx &ctx) {
+    if (lookupEvalResult(ctx))
+        return value;
     propagateType();
-    EvalResType lhs_eval_res = lhs->evaluate(ctx);
-    EvalResType rhs_eval_res = rhs->evaluate(ctx);
+    EvalResType lhs_eval_res = lhs.evaluate(ctx);
+    EvalResType rhs_eval_res = rhs.evaluate(ctx);
 
     if (lhs_eval_res->getKind() != DataKind::VAR ||
         rhs_eval_res->getKind() != DataKind::VAR) {
@@ -1524,31 +1614,43 @@ Expr::EvalResType BinaryExpr::evaluate(EvalCtx &ctx) {
 
     value = replaceValueWith(
         value,
-        std::make_shared<ScalarVar>(
+        makeIRNode<ScalarVar>(
             "",
             IntegralType::init(new_val.getIntTypeID(), false, CVQualifier::NONE,
-                               lhs->getValue()->getType()->isUniform()),
+                               lhs.getType()->isUniform()),
             new_val));
+    storeEvalResult(ctx);
     return value;
 }
 
 Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
+    invalidate();
     propagateType();
-    lhs->rebuild(ctx);
-    rhs->rebuild(ctx);
+    lhs.rebuild(ctx);
+    rhs.rebuild(ctx);
+    return repairUB(ctx);
+}
+
+Expr::EvalResType BinaryExpr::repairUB(EvalCtx &ctx) {
     std::shared_ptr<Data> eval_res = evaluate(ctx);
     assert(eval_res->getKind() == DataKind::VAR &&
            "Binary operations are supported only for Scalar Variables");
-
     auto eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
 
-    if (!eval_scalar_res->getCurrentValue().hasUB()) {
-        value = eval_res;
-        return eval_res;
+    while (eval_scalar_res->getCurrentValue().hasUB()) {
+        UBKind ub = eval_scalar_res->getCurrentValue().getUBCode();
+        Statistics::getInstance().addUB(ub);
+        fixUB(ub, ctx);
+        invalidate();
+        eval_res = evaluate(ctx);
+        eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
     }
 
-    UBKind ub = eval_scalar_res->getCurrentValue().getUBCode();
+    value = eval_res;
+    return eval_res;
+}
 
+void BinaryExpr::fixUB(UBKind ub, EvalCtx &ctx) {
     switch (op) {
         case BinaryOp::ADD:
             op = BinaryOp::SUB;
@@ -1567,16 +1669,16 @@ Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
         case BinaryOp::SHL:
             if (ub == UBKind::ShiftRhsLarge || ub == UBKind::ShiftRhsNeg) {
                 // First of all, we need to find the maximal valid shift value
-                assert(lhs->getValue()->getType()->isIntType() &&
+                assert(lhs.getType()->isIntType() &&
                        "Binary operations are supported only for Scalar "
                        "Variables of Integral Types");
                 auto lhs_int_type = std::static_pointer_cast<IntegralType>(
-                    lhs->getValue()->getType());
-                assert(lhs->getValue()->getKind() == DataKind::VAR &&
+                    lhs.getType());
+                assert(lhs.getValue()->getKind() == DataKind::VAR &&
                        "Binary operations are supported only for Scalar "
                        "Variables");
                 auto lhs_scalar_var =
-                    std::static_pointer_cast<ScalarVar>(lhs->getValue());
+                    std::static_pointer_cast<ScalarVar>(lhs.getValue());
                 // We can't shift pass the type size
                 Options &options = Options::getInstance();
                 size_t max_sht_val = lhs_int_type->getBitSize() - 1;
@@ -1598,16 +1700,16 @@ Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
 
                 // Thirdly, we need to combine the chosen value with the
                 // existing one
-                assert(rhs->getValue()->getType()->isIntType() &&
+                assert(rhs.getType()->isIntType() &&
                        "Binary operations are supported only for Scalar "
                        "Variables of Integral Types");
                 auto rhs_int_type = std::static_pointer_cast<IntegralType>(
-                    rhs->getValue()->getType());
-                assert(rhs->getValue()->getKind() == DataKind::VAR &&
+                    rhs.getType());
+                assert(rhs.getValue()->getKind() == DataKind::VAR &&
                        "Binary operations are supported only for Scalar "
                        "Variables");
                 auto rhs_scalar_var =
-                    std::static_pointer_cast<ScalarVar>(rhs->getValue());
+                    std::static_pointer_cast<ScalarVar>(rhs.getValue());
                 IRValue::AbsValue rhs_abs_val =
                     rhs_scalar_var->getCurrentValue().getAbsValue();
                 uint64_t rhs_abs_int_val =
@@ -1625,27 +1727,27 @@ Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
                 auto adjust_val = IRValue(rhs_int_type->getIntTypeId());
                 assert(new_val > 0 && "Correction values can't be negative");
                 adjust_val.setValue(IRValue::AbsValue{false, new_val});
-                auto const_val = std::make_shared<ConstantExpr>(adjust_val);
-                if (ub == UBKind::ShiftRhsNeg)
-                    rhs = std::make_shared<BinaryExpr>(BinaryOp::ADD, rhs,
-                                                       const_val);
-                // UBKind::ShiftRhsLarge
-                else
-                    rhs = std::make_shared<BinaryExpr>(BinaryOp::SUB, rhs,
-                                                       const_val);
+                auto const_val = makeIRNode<ConstantExpr>(adjust_val);
+                auto new_rhs = makeIRNode<BinaryExpr>(
+                    ub == UBKind::ShiftRhsNeg ? BinaryOp::ADD : BinaryOp::SUB,
+                    rhs, const_val);
+                new_rhs->repairUB(ctx);
+                rhs = new_rhs;
             }
             // UBKind::NegShift
             else {
                 // We can just add maximal value of the type
-                assert(lhs->getValue()->getType()->isIntType() &&
+                assert(lhs.getType()->isIntType() &&
                        "Binary operations are supported only for Scalar "
                        "Variables of Integral Types");
                 auto lhs_int_type = std::static_pointer_cast<IntegralType>(
-                    lhs->getValue()->getType());
+                    lhs.getType());
                 auto const_val =
-                    std::make_shared<ConstantExpr>(lhs_int_type->getMax());
-                lhs =
-                    std::make_shared<BinaryExpr>(BinaryOp::ADD, lhs, const_val);
+                    makeIRNode<ConstantExpr>(lhs_int_type->getMax());
+                auto new_lhs =
+                    makeIRNode<BinaryExpr>(BinaryOp::ADD, lhs, const_val);
+                new_lhs->repairUB(ctx);
+                lhs = new_lhs;
             }
             break;
         case BinaryOp::LT:
@@ -1664,23 +1766,12 @@ Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
             ERROR("Bad binary operator");
             break;
     }
-
-    do {
-        eval_res = evaluate(ctx);
-        eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
-        if (!eval_scalar_res->getCurrentValue().hasUB())
-            break;
-        rebuild(ctx);
-    } while (eval_scalar_res->getCurrentValue().hasUB());
-
-    value = eval_res;
-    return eval_res;
 }
 
-void BinaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                      std::string offset) {
-    stream << offset << "((";
-    lhs->emit(ctx, stream);
+void BinaryExpr::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                      size_t offset) {
+    stream.indent(offset) << "((";
+    lhs.emit(ctx, stream);
     stream << ")";
     switch (op) {
         case BinaryOp::ADD:
@@ -1742,12 +1833,11 @@ void BinaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
             break;
     }
     stream << "(";
-    rhs->emit(ctx, stream);
+    rhs.emit(ctx, stream);
     stream << "))";
 }
 
-BinaryExpr::BinaryExpr(BinaryOp _op, std::shared_ptr<Expr> _lhs,
-                       std::shared_ptr<Expr> _rhs)
+BinaryExpr::BinaryExpr(BinaryOp _op, Operand _lhs, Operand _rhs)
     : op(_op), lhs(std::move(_lhs)), rhs(std::move(_rhs)) {}
 
 std::shared_ptr<BinaryExpr>
@@ -1756,31 +1846,32 @@ BinaryExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     BinaryOp op = rand_val_gen->getRandId(gen_pol->binary_op_distr);
     auto lhs = ArithmeticExpr::create(ctx);
     auto rhs = ArithmeticExpr::create(ctx);
-    return std::make_shared<BinaryExpr>(op, lhs, rhs);
+    return makeIRNode<BinaryExpr>(op, lhs, rhs);
 }
 
 std::shared_ptr<Expr> BinaryExpr::copy() {
-    auto new_lhs = lhs->copy();
-    auto new_rhs = rhs->copy();
-    return std::make_shared<BinaryExpr>(op, new_lhs, new_rhs);
+    auto new_lhs = lhs.copy();
+    auto new_rhs = rhs.copy();
+    return makeIRNode<BinaryExpr>(op, new_lhs, new_rhs);
 }
 
-TernaryExpr::TernaryExpr(std::shared_ptr<Expr> _cond,
-                         std::shared_ptr<Expr> _true_br,
-                         std::shared_ptr<Expr> _false_br)
+TernaryExpr::TernaryExpr(Operand _cond, Operand _true_br, Operand _false_br)
     : cond(std::move(_cond)), true_br(std::move(_true_br)),
       false_br(std::move(_false_br)) {}
 
 bool TernaryExpr::propagateType() {
-    cond->propagateType();
-    true_br->propagateType();
-    false_br->propagateType();
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
+    cond.propagateType();
+    true_br.propagateType();
+    false_br.propagateType();
 
-    cond = convToBool(cond);
+    convToBool(cond);
 
     Options &options = Options::getInstance();
     if (options.isISPC()) {
-        if (LibCallExpr::isAnyArgVarying({cond})) {
+        if (LibCallExpr::isAnyArgVarying({cond.getType()})) {
             LibCallExpr::ispcArgPromotion(true_br);
             LibCallExpr::ispcArgPromotion(false_br);
         }
@@ -1788,18 +1879,21 @@ bool TernaryExpr::propagateType() {
     }
 
     // Arithmetic conversions
-    true_br = integralProm(true_br);
-    false_br = integralProm(false_br);
+    integralProm(true_br);
+    integralProm(false_br);
     arithConv(true_br, false_br);
 
-    value = std::make_shared<TypedData>(true_br->getValue()->getType());
+    value = makeIRNode<TypedData>(true_br.getType());
 
+    setTypePropagated();
     return true;
 }
 
 Expr::EvalResType TernaryExpr::evaluate(EvalCtx &ctx) {
+    if (lookupEvalResult(ctx))
+        return value;
     propagateType();
-    EvalResType cond_eval = cond->evaluate(ctx);
+    EvalResType cond_eval = cond.evaluate(ctx);
     if (cond_eval->getKind() != DataKind::VAR)
         ERROR("We support only scalar variables for now");
 
@@ -1807,37 +1901,39 @@ Expr::EvalResType TernaryExpr::evaluate(EvalCtx &ctx) {
         std::static_pointer_cast<ScalarVar>(cond_eval)->getCurrentValue();
 
     if (cond_val.getValueRef<bool>())
-        value = replaceValueWith(value, true_br->evaluate(ctx));
+        value = replaceValueWith(value, true_br.evaluate(ctx));
     else
-        value = replaceValueWith(value, false_br->evaluate(ctx));
+        value = replaceValueWith(value, false_br.evaluate(ctx));
 
     if (cond_eval->hasUB()) {
         auto scalar_var = std::static_pointer_cast<ScalarVar>(value);
         auto scalar_val = scalar_var->getCurrentValue();
         scalar_val.setUBCode(cond_eval->getUBCode());
-        value = std::make_shared<ScalarVar>(
+        value = makeIRNode<ScalarVar>(
             "", std::static_pointer_cast<IntegralType>(scalar_var->getType()),
             scalar_val);
     }
 
+    storeEvalResult(ctx);
     return value;
 }
 
 Expr::EvalResType TernaryExpr::rebuild(EvalCtx &ctx) {
-    cond->rebuild(ctx);
-    true_br->rebuild(ctx);
-    false_br->rebuild(ctx);
+    invalidate();
+    cond.rebuild(ctx);
+    true_br.rebuild(ctx);
+    false_br.rebuild(ctx);
     return evaluate(ctx);
 }
 
-void TernaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                       std::string offset) {
-    stream << offset << "((";
-    cond->emit(ctx, stream);
+void TernaryExpr::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                       size_t offset) {
+    stream.indent(offset) << "((";
+    cond.emit(ctx, stream);
     stream << ") ? (";
-    true_br->emit(ctx, stream);
+    true_br.emit(ctx, stream);
     stream << ") : (";
-    false_br->emit(ctx, stream);
+    false_br.emit(ctx, stream);
     stream << "))";
 }
 
@@ -1847,28 +1943,31 @@ TernaryExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     auto true_br = ArithmeticExpr::create(ctx);
     auto false_br = ArithmeticExpr::create(ctx);
 
-    return std::make_shared<TernaryExpr>(cond, true_br, false_br);
+    return makeIRNode<TernaryExpr>(cond, true_br, false_br);
 }
 
 std::shared_ptr<Expr> TernaryExpr::copy() {
-    auto new_cond = cond->copy();
-    auto new_true_br = true_br->copy();
-    auto new_false_br = false_br->copy();
-    return std::make_shared<TernaryExpr>(new_cond, new_true_br, new_false_br);
+    auto new_cond = cond.copy();
+    auto new_true_br = true_br.copy();
+    auto new_false_br = false_br.copy();
+    return makeIRNode<TernaryExpr>(new_cond, new_true_br, new_false_br);
 }
 
 bool SubscriptExpr::propagateType() {
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
     array->propagateType();
     idx->propagateType();
 
     auto array_type =
         std::static_pointer_cast<ArrayType>(array->getValue()->getType());
     if (active_dim < array_type->getDimensions().size() - 1)
-        value = std::make_shared<TypedData>(array_type);
+        value = makeIRNode<TypedData>(array_type);
     else {
         if (!array_type->getBaseType()->isIntType())
             ERROR("Only integral types are supported for now");
-        value = std::make_shared<TypedData>(array_type->getBaseType());
+        value = makeIRNode<TypedData>(array_type->getBaseType());
     }
 
     Options &options = Options::getInstance();
@@ -1878,6 +1977,7 @@ bool SubscriptExpr::propagateType() {
         value->getType()->isUniform())
         value = value->makeVarying();
 
+    setTypePropagated();
     return true;
 }
 
@@ -1911,27 +2011,55 @@ bool SubscriptExpr::inBounds(size_t dim, std::shared_ptr<Data> idx_val,
     return false;
 }
 
+// Elements along the axis with multiple values have the main values if their
+// index has the residue main_val_idx, and the alternative ones otherwise
+static bool isMainValsResidue(int64_t residue) {
+    auto vals_number =
+        static_cast<int64_t>(Options::getInstance().getValsNumber());
+    residue = (residue % vals_number + vals_number) % vals_number;
+    return residue == static_cast<int64_t>(Options::main_val_idx);
+}
+
+bool SubscriptExpr::iterSelectsMainVals(bool use_main_vals) {
+    // The iterator is on the residue main_val_idx for the main values and on
+    // any other residue for the alternative ones. Only with two values it is a
+    // single residue, so the offset is a multiple of the number of values
+    // otherwise (see initImpl()).
+    assert((Options::getInstance().getValsNumber() == 2 ||
+            stencil_offset % static_cast<int64_t>(
+                                 Options::getInstance().getValsNumber()) ==
+                0) &&
+           "Offset along the axis with multiple values is ambiguous");
+    size_t residue =
+        use_main_vals ? Options::main_val_idx : Options::alt_val_idx;
+    return isMainValsResidue(static_cast<int64_t>(residue) + stencil_offset);
+}
+
+// A constant subscript selects the same values in every iteration, no matter
+// which values the iterators select
+bool SubscriptExpr::constSelectsMainVals(std::shared_ptr<Data> idx_val) {
+    size_t vals_number = Options::getInstance().getValsNumber();
+    uint64_t residue = std::static_pointer_cast<ScalarVar>(idx_val)
+                           ->getCurrentValue()
+                           .getAbsValue()
+                           .value %
+                       vals_number;
+    return isMainValsResidue(static_cast<int64_t>(residue) + stencil_offset);
+}
+
 Expr::EvalResType SubscriptExpr::evaluate(EvalCtx &ctx) {
     propagateType();
 
     bool old_use_main_vals = ctx.use_main_vals;
-    bool flip_main_vals =
-        at_mul_val_axis &&
-        std::abs(stencil_offset) % Options::vals_number == Options::alt_val_idx;
+    bool const_idx = idx->getKind() == IRNodeKind::CONST;
     // TODO: check if this escapes the scope
-    ctx.use_main_vals = flip_main_vals ? !ctx.use_main_vals : ctx.use_main_vals;
+    if (at_mul_val_axis && !const_idx)
+        ctx.use_main_vals = iterSelectsMainVals(ctx.use_main_vals);
 
     EvalResType idx_eval_res = idx->evaluate(ctx);
 
-    if (at_mul_val_axis && idx->getKind() == IRNodeKind::CONST) {
-        bool use_main_vals = std::static_pointer_cast<ScalarVar>(idx_eval_res)
-                                     ->getCurrentValue()
-                                     .getAbsValue()
-                                     .value %
-                                 Options::vals_number ==
-                             Options::main_val_idx;
-        ctx.use_main_vals = use_main_vals;
-    }
+    if (at_mul_val_axis && const_idx)
+        ctx.use_main_vals = constSelectsMainVals(idx_eval_res);
 
     EvalResType array_eval_res = array->evaluate(ctx);
 
@@ -1969,7 +2097,7 @@ Expr::EvalResType SubscriptExpr::evaluate(EvalCtx &ctx) {
         if (!array_type->isUniform())
             value_type->makeVarying();
         value = replaceValueWith(
-            value, std::make_shared<ScalarVar>(
+            value, makeIRNode<ScalarVar>(
                        "",
                        std::static_pointer_cast<IntegralType>(
                            array_type->getBaseType()),
@@ -1984,6 +2112,7 @@ Expr::EvalResType SubscriptExpr::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType SubscriptExpr::rebuild(EvalCtx &ctx) {
+    invalidate();
     propagateType();
     idx->rebuild(ctx);
     array->rebuild(ctx);
@@ -1993,11 +2122,13 @@ Expr::EvalResType SubscriptExpr::rebuild(EvalCtx &ctx) {
 
     assert(eval_res->getUBCode() == UBKind::OutOfBounds &&
            "Every other UB should be handled before");
+    Statistics::getInstance().addUB(UBKind::OutOfBounds);
 
     IRValue active_size_val(idx_int_type_id);
     active_size_val.setValue({false, active_size});
-    auto size_constant = std::make_shared<ConstantExpr>(active_size_val);
-    idx = std::make_shared<BinaryExpr>(BinaryOp::MOD, idx, size_constant);
+    auto size_constant = makeIRNode<ConstantExpr>(active_size_val);
+    idx = makeIRNode<BinaryExpr>(BinaryOp::MOD, idx, size_constant);
+    invalidate();
 
     eval_res = evaluate(ctx);
     assert(eval_res->hasUB() && "All of the UB should be fixed by now");
@@ -2005,9 +2136,9 @@ Expr::EvalResType SubscriptExpr::rebuild(EvalCtx &ctx) {
     return eval_res;
 }
 
-void SubscriptExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                         std::string offset) {
-    stream << offset;
+void SubscriptExpr::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                         size_t offset) {
+    stream.indent(offset);
     // TODO: it may cause some problems in the future
     array->emit(ctx, stream);
     stream << " [";
@@ -2060,11 +2191,11 @@ SubscriptExpr::SubscriptExpr(std::shared_ptr<Expr> _arr,
 }
 
 void SubscriptExpr::setValue(std::shared_ptr<Expr> _expr, bool use_main_vals) {
-    bool flip_main_vals =
-        at_mul_val_axis &&
-        std::abs(stencil_offset) % Options::vals_number == Options::alt_val_idx;
-    // TODO: check if this escapes the scope
-    use_main_vals = flip_main_vals ? !use_main_vals : use_main_vals;
+    // The store has to go to the values that evaluate() has read
+    if (at_mul_val_axis && idx->getKind() == IRNodeKind::CONST)
+        use_main_vals = constSelectsMainVals(idx->getValue());
+    else if (at_mul_val_axis)
+        use_main_vals = iterSelectsMainVals(use_main_vals);
 
     if (array->getKind() == IRNodeKind::SUBSCRIPT) {
         auto subs = std::static_pointer_cast<SubscriptExpr>(array);
@@ -2126,8 +2257,8 @@ SubscriptExpr::initImpl(ArrayStencilParams array_params,
 
     // Extract offsets distribution, so we don't have to do it every iteration
     auto find_res =
-        gen_pol->stencil_in_dim_prob.find(array_type->getDimensions().size());
-    if (find_res == gen_pol->stencil_in_dim_prob.end())
+        gen_pol->stencil_in_dim_prob->find(array_type->getDimensions().size());
+    if (find_res == gen_pol->stencil_in_dim_prob->end())
         ERROR("We can't have arrays that have more dimensions than the total "
               "limit");
     auto stencil_in_dim_prob = find_res->second;
@@ -2250,12 +2381,13 @@ SubscriptExpr::initImpl(ArrayStencilParams array_params,
             };
             uint64_t init_val = roll_const();
             if (single_val_override) {
-                while (init_val % Options::vals_number != Options::main_val_idx)
+                size_t vals_number = Options::getInstance().getValsNumber();
+                while (init_val % vals_number != Options::main_val_idx)
                     init_val = roll_const();
             }
             IRValue new_val(rand_val_gen->getRandId(gen_pol->int_type_distr));
             new_val.setValue(IRValue::AbsValue{false, init_val});
-            iter_use_expr = std::make_shared<ConstantExpr>(new_val);
+            iter_use_expr = makeIRNode<ConstantExpr>(new_val);
         }
         else if (subs_kind == SubscriptKind::ITER ||
                  subs_kind == SubscriptKind::OFFSET ||
@@ -2330,7 +2462,7 @@ SubscriptExpr::initImpl(ArrayStencilParams array_params,
                     ERROR("Unknown dims order kind");
             }
             assert(iter && "Iterator not defined");
-            iter_use_expr = std::make_shared<IterUseExpr>(iter);
+            iter_use_expr = IterUseExpr::init(iter);
         }
         else if (subs_kind == SubscriptKind::REPEAT) {
             auto repeated_elem = rand_val_gen->getRandElem(subs_exprs);
@@ -2364,6 +2496,16 @@ SubscriptExpr::initImpl(ArrayStencilParams array_params,
         subs_exprs.emplace_back(iter_use_expr, offset);
     }
 
+    // The iterator doesn't tell which of the alternative values it is on, so
+    // with more than two values we can only shift it by whole periods. The
+    // offset is rounded towards zero, so it stays within the bounds.
+    auto vals_number =
+        static_cast<int64_t>(Options::getInstance().getValsNumber());
+    if (mul_val_axis_idx != -1 && vals_number > 2) {
+        int64_t &offset = subs_exprs.at(mul_val_axis_idx).second;
+        offset -= offset % vals_number;
+    }
+
     if (array_params.getDimsOrderKind() == SubscriptOrderKind::REVERSE ||
         (!dims_defined && dims_order_kind == SubscriptOrderKind::REVERSE)) {
         // We want to guarantee that the subscript with multiple values remains
@@ -2378,13 +2520,15 @@ SubscriptExpr::initImpl(ArrayStencilParams array_params,
             std::reverse(subs_exprs.begin(), subs_exprs.end());
     }
 
-    std::shared_ptr<Expr> res_expr = std::make_shared<ArrayUseExpr>(array);
+    std::shared_ptr<Expr> res_expr = ArrayUseExpr::init(array);
     for (size_t i = 0; i < subs_exprs.size(); ++i) {
         auto new_expr =
-            std::make_shared<SubscriptExpr>(res_expr, subs_exprs.at(i).first);
+            makeIRNode<SubscriptExpr>(res_expr, subs_exprs.at(i).first);
         new_expr->active_dim = i;
         new_expr->setOffset(subs_exprs.at(i).second);
         new_expr->at_mul_val_axis = mul_val_axis_idx == static_cast<int64_t>(i);
+        // The type was propagated by the constructor for the first dimension
+        new_expr->invalidate();
         res_expr = new_expr;
     }
 
@@ -2396,15 +2540,17 @@ SubscriptExpr::initImpl(ArrayStencilParams array_params,
 std::shared_ptr<Expr> SubscriptExpr::copy() {
     auto new_arr = array->copy();
     auto new_idx = idx->copy();
-    auto ret = std::make_shared<SubscriptExpr>(new_arr, new_idx);
+    auto ret = makeIRNode<SubscriptExpr>(new_arr, new_idx);
     ret->active_dim = active_dim;
     ret->active_size = active_size;
     ret->idx_int_type_id = idx_int_type_id;
     ret->stencil_offset = stencil_offset;
+    ret->invalidate();
     return ret;
 }
 
 bool AssignmentExpr::propagateType() {
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
     to->propagateType();
     from->propagateType();
 
@@ -2413,8 +2559,8 @@ bool AssignmentExpr::propagateType() {
     auto from_int_type =
         std::static_pointer_cast<IntegralType>(from->getValue()->getType());
     if (to_int_type != from_int_type) {
-        from = std::make_shared<TypeCastExpr>(from, to_int_type,
-                                              /*is_implicit*/ true);
+        from = makeIRNode<TypeCastExpr>(from, to_int_type,
+                                        /*is_implicit*/ true);
         from->propagateType();
     }
 
@@ -2424,20 +2570,20 @@ bool AssignmentExpr::propagateType() {
             second_from->getValue()->getType());
         if (to_int_type != second_from_int_type)
             second_from =
-                std::make_shared<TypeCastExpr>(second_from, to_int_type, true);
+                makeIRNode<TypeCastExpr>(second_from, to_int_type, true);
         second_from->propagateType();
     }
 
     // TODO: what do we do with the second value? For now it doesn't really
     //  matter, because the types match, and it's all we care about here
-    value = std::make_shared<TypedData>(from->getValue()->getType());
+    value = makeIRNode<TypedData>(from->getValue()->getType());
 
     return true;
 }
 
 Expr::EvalResType AssignmentExpr::evaluate(EvalCtx &ctx) {
     if (!ctx.use_main_vals && second_from == nullptr) {
-        second_from = from->copy();
+        second_from = from;
     }
 
     propagateType();
@@ -2500,6 +2646,10 @@ void AssignmentExpr::propagateValue(EvalCtx &ctx) {
 
 Expr::EvalResType AssignmentExpr::rebuild(EvalCtx &ctx) {
     propagateType();
+    // UB repair for the main values must not change the expression for the
+    // alternative ones and vice versa
+    if (second_from == from)
+        second_from = from->copy();
     to->rebuild(ctx);
     auto new_ctx = ctx;
     new_ctx.use_main_vals = true;
@@ -2513,9 +2663,9 @@ Expr::EvalResType AssignmentExpr::rebuild(EvalCtx &ctx) {
     return evaluate(ctx);
 }
 
-void AssignmentExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
-    stream << offset;
+void AssignmentExpr::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                          size_t offset) {
+    stream.indent(offset);
     to->emit(ctx, stream);
     stream << " = ";
 
@@ -2537,7 +2687,7 @@ void AssignmentExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
         stream << "("
                << (cast_to_uniform ? "programIndex"
                                    : versioning_iter->getName(ctx))
-               << " % " << Options::vals_number << " == ";
+               << " % " << options.getValsNumber() << " == ";
         stream << (use_zero_as_var ? "zero"
                                    : std::to_string(Options::main_val_idx))
                << ") ? (";
@@ -2551,7 +2701,9 @@ void AssignmentExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
         stream << ")";
         // TODO: we need to check that this is emitted only for scalar variables
         if (cast_to_uniform)
-            stream << ", " << (ISPC_MAX_VECTOR_SIZE % Options::vals_number)
+            stream << ", "
+                   << (ISPC_MAX_VECTOR_SIZE %
+                       Options::getInstance().getValsNumber())
                    << ")";
     }
 }
@@ -2584,7 +2736,7 @@ AssignmentExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     if (!from_val->getType()->isUniform()) {
         auto find_res = std::find_if(
             gen_pol->out_kind_distr.begin(), gen_pol->out_kind_distr.end(),
-            [](Probability<DataKind> &p) {
+            [](const Probability<DataKind> &p) {
                 return p.getId() == DataKind::ARR && p.getProb() > 0.0;
             });
         if (find_res != gen_pol->out_kind_distr.end())
@@ -2594,7 +2746,7 @@ AssignmentExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     if ((out_kind == DataKind::VAR || ctx->getLoopDepth() == 0)) {
         auto new_var = ScalarVar::create(ctx);
         ctx->getExtOutSymTable()->addVar(new_var);
-        auto new_scalar_use_expr = std::make_shared<ScalarVarUseExpr>(new_var);
+        auto new_scalar_use_expr = ScalarVarUseExpr::init(new_var);
         new_scalar_use_expr->setIsDead(false);
         to = new_scalar_use_expr;
     }
@@ -2610,16 +2762,16 @@ AssignmentExpr::create(std::shared_ptr<PopulateCtx> ctx) {
 
     if (!from_val->getType()->isUniform() &&
         to->getValue()->getType()->isUniform())
-        from = std::make_shared<ExtractCall>(from);
+        from = makeIRNode<ExtractCall>(from);
 
-    return std::make_shared<AssignmentExpr>(to, from, ctx->isTaken());
+    return makeIRNode<AssignmentExpr>(to, from, ctx->isTaken());
 }
 
 std::shared_ptr<Expr> AssignmentExpr::copy() {
     auto new_from = from->copy();
     auto new_to = to->copy();
-    auto ret = std::make_shared<AssignmentExpr>(new_to, new_from, taken);
-    ret->second_from = second_from;
+    auto ret = makeIRNode<AssignmentExpr>(new_to, new_from, taken);
+    ret->second_from = second_from == from ? new_from : second_from;
     ret->versioning_iter = versioning_iter;
     return ret;
 }
@@ -2635,31 +2787,160 @@ AssignmentExpr::AssignmentExpr(std::shared_ptr<Expr> _to,
 
 bool ReductionExpr::propagateType() { return AssignmentExpr::propagateType(); }
 
+// Straightforward step-by-step evaluation of the reduction. It detects UB
+// automatically. The only state of the reduction is its current value, so once
+// the value starts to repeat with a period of one or two iterations (e.g. for
+// XOR, or after a division drops it to zero), the result is known.
+// Step-by-step evaluation is limited to ITERATIONS_THRESHOLD_FOR_REDUCTION
+// iterations. If it is not enough, we conservatively report UB.
 template <class BinOp>
-static IRValue reductionHelper(IRValue base, IRValue inc,
+static IRValue reductionLoop(IRValue base, IRValue inc, IntTypeID max_type_id,
+                             size_t total_iters_num, BinOp foo) {
+    IntTypeID base_type_id = base.getIntTypeID();
+    bool need_to_cast_ret = base_type_id != max_type_id;
+
+    IRValue prev = base;
+    IRValue ret = base;
+    for (size_t i = 0; i < total_iters_num; i++) {
+        if (i >= ITERATIONS_THRESHOLD_FOR_REDUCTION)
+            return IRValue(base_type_id);
+        IRValue next =
+            foo((need_to_cast_ret ? ret.castToType(max_type_id) : ret), inc)
+                .castToType(base_type_id);
+        if (next.hasUB())
+            return next;
+        if (next.getAbsValue() == ret.getAbsValue())
+            return next;
+        if (i > 0 && next.getAbsValue() == prev.getAbsValue())
+            return (total_iters_num - i - 1) % 2 == 0 ? next : ret;
+        prev = ret;
+        ret = next;
+    }
+    return ret;
+}
+
+static uint64_t getModValue(IRValue val) {
+    IRValue ret = val.castToType(IntTypeID::ULLONG);
+    return ret.getValueRef<uint64_t>();
+}
+
+// Computes the result of the reduction, assuming that it doesn't have UB.
+// The arithmetic is done modulo 2^64, which agrees with the truncation to
+// the type of the result after each iteration.
+static IRValue reductionClosedForm(BinaryOp bin_op, IRValue base, IRValue inc,
+                                   size_t total_iters_num) {
+    uint64_t base_val = getModValue(base);
+    uint64_t inc_val = getModValue(inc);
+    uint64_t iters_num = total_iters_num;
+    uint64_t res_val = 0;
+    switch (bin_op) {
+        case BinaryOp::ADD:
+            res_val = base_val + iters_num * inc_val;
+            break;
+        case BinaryOp::SUB:
+            res_val = base_val - iters_num * inc_val;
+            break;
+        case BinaryOp::MUL:
+            // Exponentiation by squaring
+            res_val = base_val;
+            for (; iters_num != 0; iters_num >>= 1) {
+                if (iters_num & 1)
+                    res_val *= inc_val;
+                inc_val *= inc_val;
+            }
+            break;
+        case BinaryOp::BIT_XOR:
+            res_val = iters_num % 2 == 0 ? base_val : base_val ^ inc_val;
+            break;
+        default:
+            ERROR("Unsupported Binary Operation");
+    }
+    IRValue ret(IntTypeID::ULLONG, {false, res_val});
+    return ret.castToType(base.getIntTypeID());
+}
+
+// Checks if the additive reduction overflows the signed type of its operands.
+// The value changes monotonically, so it is enough to check the last one.
+static bool additiveReductionHasUB(BinaryOp bin_op, IRValue base, IRValue inc,
+                                   std::shared_ptr<IntegralType> int_type,
+                                   size_t total_iters_num) {
+    int64_t base_val = base.castToType(IntTypeID::LLONG).getValueRef<int64_t>();
+    int64_t inc_val = inc.castToType(IntTypeID::LLONG).getValueRef<int64_t>();
+    int64_t min_val =
+        int_type->getMin().castToType(IntTypeID::LLONG).getValueRef<int64_t>();
+    int64_t max_val =
+        int_type->getMax().castToType(IntTypeID::LLONG).getValueRef<int64_t>();
+
+    // Everything is done in unsigned types to avoid overflows
+    bool goes_up = (bin_op == BinaryOp::ADD) == (inc_val >= 0);
+    uint64_t step = inc_val >= 0 ? static_cast<uint64_t>(inc_val)
+                                 : -static_cast<uint64_t>(inc_val);
+    if (step == 0)
+        return false;
+    uint64_t room =
+        goes_up
+            ? static_cast<uint64_t>(max_val) - static_cast<uint64_t>(base_val)
+            : static_cast<uint64_t>(base_val) - static_cast<uint64_t>(min_val);
+    return room / step < total_iters_num;
+}
+
+template <class BinOp>
+static IRValue reductionHelper(BinaryOp bin_op, IRValue base, IRValue inc,
                                size_t total_iters_num, BinOp foo) {
-    auto tmp_op = std::make_shared<BinaryExpr>(
-        BinaryOp::ADD, std::make_shared<ConstantExpr>(base),
-        std::make_shared<ConstantExpr>(inc));
+    auto tmp_op = makeIRNode<BinaryExpr>(
+        BinaryOp::ADD, makeIRNode<ConstantExpr>(base),
+        makeIRNode<ConstantExpr>(inc));
     tmp_op->propagateType();
     auto max_int_type =
         std::static_pointer_cast<IntegralType>(tmp_op->getValue()->getType());
     IntTypeID max_type_id = max_int_type->getIntTypeId();
+    IntTypeID base_type_id = base.getIntTypeID();
 
-    // IRValue approach is about as fast as approach with C++ types, but it
-    // detects UB automatically
-    // Ideally, we want to come up with a precise formula for result
     IRValue conv_inc =
         inc.getIntTypeID() == max_type_id ? inc : inc.castToType(max_type_id);
-    bool need_to_cast_ret = base.getIntTypeID() != max_type_id;
 
-    IRValue ret = base;
-    for (size_t i = 0; i < total_iters_num; i++) {
-        ret = foo((need_to_cast_ret ? ret.castToType(max_type_id) : ret),
-                  conv_inc)
-                  .castToType(base.getIntTypeID());
+    if (total_iters_num == 0)
+        return base;
+    if (base.hasUB() || conv_inc.hasUB())
+        return IRValue(base_type_id);
+
+    // Try to compute the result in O(1) or O(log n) instead of iterating.
+    // Conversion to bool is not a truncation, so it has to be evaluated
+    // step by step.
+    bool has_closed_form =
+        (bin_op == BinaryOp::ADD || bin_op == BinaryOp::SUB ||
+         bin_op == BinaryOp::MUL || bin_op == BinaryOp::BIT_XOR) &&
+        base_type_id != IntTypeID::BOOL;
+    if (has_closed_form) {
+        bool ub_free = true;
+        if (max_int_type->getIsSigned() && bin_op != BinaryOp::BIT_XOR) {
+            if (base_type_id != max_type_id) {
+                // The current value always fits into the type of the result,
+                // and the operation is linear in it, so it is enough to check
+                // the minimal and the maximal values of that type
+                auto base_type = IntegralType::init(base_type_id);
+                ub_free =
+                    !foo(base_type->getMin().castToType(max_type_id), conv_inc)
+                         .hasUB() &&
+                    !foo(base_type->getMax().castToType(max_type_id), conv_inc)
+                         .hasUB();
+            }
+            else if (bin_op != BinaryOp::MUL) {
+                if (additiveReductionHasUB(bin_op, base, conv_inc,
+                                           max_int_type, total_iters_num))
+                    return IRValue(base_type_id);
+            }
+            else
+                // Multiplication either overflows or gets into a cycle
+                // after a few iterations, so the loop below handles it
+                ub_free = false;
+        }
+        if (ub_free)
+            return reductionClosedForm(bin_op, base, conv_inc,
+                                       total_iters_num);
     }
-    return ret;
+
+    return reductionLoop(base, conv_inc, max_type_id, total_iters_num, foo);
 }
 
 Expr::EvalResType ReductionExpr::evaluate(EvalCtx &ctx) {
@@ -2696,41 +2977,41 @@ Expr::EvalResType ReductionExpr::evaluate(EvalCtx &ctx) {
     if (bin_op != BinaryOp::MAX_BIN_OP) {
         switch (bin_op) {
             case BinaryOp::ADD:
-                result_expr = std::make_shared<ConstantExpr>(
-                    reductionHelper(to_eval_val, from_eval_val,
+                result_expr = makeIRNode<ConstantExpr>(
+                    reductionHelper(bin_op, to_eval_val, from_eval_val,
                                     ctx.total_iter_num, std::plus()));
                 break;
             case BinaryOp::SUB:
-                result_expr = std::make_shared<ConstantExpr>(
-                    reductionHelper(to_eval_val, from_eval_val,
+                result_expr = makeIRNode<ConstantExpr>(
+                    reductionHelper(bin_op, to_eval_val, from_eval_val,
                                     ctx.total_iter_num, std::minus()));
                 break;
             case BinaryOp::MUL:
-                result_expr = std::make_shared<ConstantExpr>(
-                    reductionHelper(to_eval_val, from_eval_val,
+                result_expr = makeIRNode<ConstantExpr>(
+                    reductionHelper(bin_op, to_eval_val, from_eval_val,
                                     ctx.total_iter_num, std::multiplies()));
                 break;
             case BinaryOp::DIV:
-                result_expr = std::make_shared<ConstantExpr>(
-                    reductionHelper(to_eval_val, from_eval_val,
+                result_expr = makeIRNode<ConstantExpr>(
+                    reductionHelper(bin_op, to_eval_val, from_eval_val,
                                     ctx.total_iter_num, std::divides()));
                 break;
             case BinaryOp::MOD:
-                result_expr = std::make_shared<ConstantExpr>(
-                    reductionHelper(to_eval_val, from_eval_val,
+                result_expr = makeIRNode<ConstantExpr>(
+                    reductionHelper(bin_op, to_eval_val, from_eval_val,
                                     ctx.total_iter_num, std::modulus()));
                 break;
             case BinaryOp::BIT_AND:
                 result_expr =
-                    std::make_shared<BinaryExpr>(BinaryOp::BIT_AND, to, from);
+                    makeIRNode<BinaryExpr>(BinaryOp::BIT_AND, to, from);
                 break;
             case BinaryOp::BIT_OR:
                 result_expr =
-                    std::make_shared<BinaryExpr>(BinaryOp::BIT_OR, to, from);
+                    makeIRNode<BinaryExpr>(BinaryOp::BIT_OR, to, from);
                 break;
             case BinaryOp::BIT_XOR:
-                result_expr = std::make_shared<ConstantExpr>(
-                    reductionHelper(to_eval_val, from_eval_val,
+                result_expr = makeIRNode<ConstantExpr>(
+                    reductionHelper(bin_op, to_eval_val, from_eval_val,
                                     ctx.total_iter_num, std::bit_xor()));
                 break;
             default:
@@ -2740,10 +3021,10 @@ Expr::EvalResType ReductionExpr::evaluate(EvalCtx &ctx) {
     else if (lib_call_kind != LibCallKind::MAX_LIB_CALL_KIND) {
         switch (lib_call_kind) {
             case LibCallKind::MAX:
-                result_expr = std::make_shared<MaxCall>(to, from);
+                result_expr = makeIRNode<MaxCall>(to, from);
                 break;
             case LibCallKind::MIN:
-                result_expr = std::make_shared<MinCall>(to, from);
+                result_expr = makeIRNode<MinCall>(to, from);
                 break;
             default:
                 ERROR("Unsupported Lib Call");
@@ -2751,7 +3032,7 @@ Expr::EvalResType ReductionExpr::evaluate(EvalCtx &ctx) {
     }
 
     result_expr =
-        std::make_shared<TypeCastExpr>(result_expr, to_int_type, true);
+        makeIRNode<TypeCastExpr>(result_expr, to_int_type, true);
     result_expr->propagateType();
     auto result_expr_eval_res = result_expr->evaluate(ctx);
     if (result_expr_eval_res->hasUB())
@@ -2795,6 +3076,7 @@ Expr::EvalResType ReductionExpr::rebuild(EvalCtx &ctx) {
     from->rebuild(ctx);
     auto ret = evaluate(ctx);
     if (ret->hasUB()) {
+        Statistics::getInstance().addUB(ret->getUBCode());
         is_degenerate = true;
         ret = rebuild(ctx);
     }
@@ -2802,14 +3084,14 @@ Expr::EvalResType ReductionExpr::rebuild(EvalCtx &ctx) {
     return ret;
 }
 
-void ReductionExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                         std::string offset) {
+void ReductionExpr::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                         size_t offset) {
     if (is_degenerate) {
         AssignmentExpr::emit(ctx, stream, offset);
         return;
     }
 
-    stream << offset;
+    stream.indent(offset);
     to->emit(ctx, stream);
 
     if (bin_op != BinaryOp::MAX_BIN_OP) {
@@ -2869,7 +3151,7 @@ ReductionExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     // For "|" and "&" we allow to use arrays as a reduction variable
     if (bin_op != BinaryOp::BIT_AND && bin_op != BinaryOp::BIT_OR) {
         bool other_option_exists = false;
-        for (auto &kind_prob : new_gen_pol->out_kind_distr) {
+        for (auto &kind_prob : new_gen_pol->out_kind_distr.getMutable()) {
             if (kind_prob.getId() == DataKind::ARR)
                 kind_prob.setProb(0);
             else if (kind_prob.getProb() > 0)
@@ -2877,7 +3159,7 @@ ReductionExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         }
         if (!other_option_exists) {
             auto base_assign_expr = AssignmentExpr::create(ctx);
-            return std::make_shared<ReductionExpr>(
+            return makeIRNode<ReductionExpr>(
                 base_assign_expr, BinaryOp::MAX_BIN_OP,
                 LibCallKind::MAX_LIB_CALL_KIND, true, ctx->isTaken());
         }
@@ -2901,7 +3183,8 @@ ReductionExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         if (base_int_type->getIntTypeId() == IntTypeID::BOOL) {
             new_gen_pol = std::make_shared<GenPolicy>(*gen_pol);
             bool bin_op_red_is_supported = false;
-            for (auto &kind_prob : new_gen_pol->reduction_bin_op_distr) {
+            for (auto &kind_prob :
+                 new_gen_pol->reduction_bin_op_distr.getMutable()) {
                 if (kind_prob.getId() != BinaryOp::BIT_AND &&
                     kind_prob.getId() != BinaryOp::BIT_OR &&
                     kind_prob.getId() != BinaryOp::BIT_XOR)
@@ -2911,7 +3194,7 @@ ReductionExpr::create(std::shared_ptr<PopulateCtx> ctx) {
             }
 
             if (!bin_op_red_is_supported)
-                return std::make_shared<ReductionExpr>(
+                return makeIRNode<ReductionExpr>(
                     base_assign_expr, BinaryOp::MAX_BIN_OP,
                     LibCallKind::MAX_LIB_CALL_KIND, true, ctx->isTaken());
 
@@ -2920,14 +3203,14 @@ ReductionExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         }
     }
 
-    return std::make_shared<ReductionExpr>(base_assign_expr, bin_op, lib_call,
-                                           false, ctx->isTaken());
+    return makeIRNode<ReductionExpr>(base_assign_expr, bin_op, lib_call,
+                                     false, ctx->isTaken());
 }
 
 std::shared_ptr<Expr> ReductionExpr::copy() {
     auto new_result_expr = result_expr->copy();
     auto new_assign = AssignmentExpr::copy();
-    auto new_reduction = std::make_shared<ReductionExpr>(
+    auto new_reduction = makeIRNode<ReductionExpr>(
         std::static_pointer_cast<AssignmentExpr>(new_assign), bin_op,
         lib_call_kind, is_degenerate, taken);
     new_reduction->result_expr = new_result_expr;
@@ -2972,15 +3255,15 @@ LibCallExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         ERROR("Unsupported call");
 }
 
-bool LibCallExpr::isAnyArgVarying(std::vector<std::shared_ptr<Expr>> args) {
-    return std::any_of(args.begin(), args.end(), [](std::shared_ptr<Expr> arg) {
-        return !arg->getValue()->getType()->isUniform();
-    });
-    return false;
+bool LibCallExpr::isAnyArgVarying(
+    const std::vector<std::shared_ptr<Type>> &arg_types) {
+    return std::any_of(
+        arg_types.begin(), arg_types.end(),
+        [](const std::shared_ptr<Type> &type) { return !type->isUniform(); });
 }
 
-void static ispcBoolPromotion(std::shared_ptr<Expr> &expr) {
-    auto expr_type = expr->getValue()->getType();
+void static ispcBoolPromotion(Operand &expr) {
+    auto expr_type = expr.getType();
     if (!expr_type->isIntType())
         ERROR("We support only Integral Types for now");
     auto expr_int_type = std::static_pointer_cast<IntegralType>(expr_type);
@@ -2992,24 +3275,23 @@ void static ispcBoolPromotion(std::shared_ptr<Expr> &expr) {
     if (!expr_int_type->isUniform())
         int_type =
             std::static_pointer_cast<IntegralType>(int_type->makeVarying());
-    expr = std::make_shared<TypeCastExpr>(expr, int_type, false);
+    expr = makeIRNode<TypeCastExpr>(expr, int_type, false);
 }
 
-void LibCallExpr::ispcArgPromotion(std::shared_ptr<Expr> &arg) {
-    auto arg_type = arg->getValue()->getType();
+void LibCallExpr::ispcArgPromotion(Operand &arg) {
+    auto arg_type = arg.getType();
     if (!arg_type->isUniform())
         return;
-    arg_type = arg_type->makeVarying();
-    arg = std::make_shared<TypeCastExpr>(arg, arg_type, true);
+    arg.addImplicitConv(arg_type->makeVarying());
 }
 
-IntTypeID LibCallExpr::getTopIntID(std::vector<std::shared_ptr<Expr>> args) {
-    if (args.empty())
+IntTypeID
+LibCallExpr::getTopIntID(const std::vector<std::shared_ptr<Type>> &arg_types) {
+    if (arg_types.empty())
         return IntTypeID::MAX_INT_TYPE_ID;
 
     IntTypeID top_id = IntTypeID::BOOL;
-    for (const auto &arg : args) {
-        auto arg_type = arg->getValue()->getType();
+    for (const auto &arg_type : arg_types) {
         if (!arg_type->isIntType())
             ERROR("We support only Integral Types for now");
         auto arg_int_type = std::static_pointer_cast<IntegralType>(arg_type);
@@ -3018,32 +3300,31 @@ IntTypeID LibCallExpr::getTopIntID(std::vector<std::shared_ptr<Expr>> args) {
     return top_id;
 }
 
-void LibCallExpr::cxxArgPromotion(std::shared_ptr<Expr> &arg,
-                                  IntTypeID type_id) {
-    auto arg_type = arg->getValue()->getType();
+void LibCallExpr::cxxArgPromotion(Operand &arg, IntTypeID type_id) {
+    auto arg_type = arg.getType();
     if (!arg_type->isIntType())
         ERROR("We support only Integral Types for now");
     auto arg_int_type = std::static_pointer_cast<IntegralType>(arg_type);
     if (arg_int_type->getIntTypeId() == type_id)
         return;
-    arg = std::make_shared<TypeCastExpr>(
-        arg,
-        IntegralType::init(type_id, arg_type->getIsStatic(),
-                           arg_type->getCVQualifier(), arg_type->isUniform()),
-        true);
+    arg.addImplicitConv(IntegralType::init(type_id, arg_type->getIsStatic(),
+                                           arg_type->getCVQualifier(),
+                                           arg_type->isUniform()));
 }
 
-MinMaxCallBase::MinMaxCallBase(std::shared_ptr<Expr> _a,
-                               std::shared_ptr<Expr> _b, LibCallKind _kind)
+MinMaxCallBase::MinMaxCallBase(Operand _a, Operand _b, LibCallKind _kind)
     : a(std::move(_a)), b(std::move(_b)), kind(_kind) {}
 
 bool MinMaxCallBase::propagateType() {
-    a->propagateType();
-    b->propagateType();
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
+    a.propagateType();
+    b.propagateType();
 
     Options &options = Options::getInstance();
     if (options.isISPC()) {
-        bool any_varying = isAnyArgVarying({a, b});
+        bool any_varying = isAnyArgVarying({a.getType(), b.getType()});
         if (any_varying) {
             ispcArgPromotion(a);
             ispcArgPromotion(b);
@@ -3052,19 +3333,22 @@ bool MinMaxCallBase::propagateType() {
         ispcBoolPromotion(b);
     }
 
-    IntTypeID top_type_id = getTopIntID({a, b});
+    IntTypeID top_type_id = getTopIntID({a.getType(), b.getType()});
     cxxArgPromotion(a, top_type_id);
     cxxArgPromotion(b, top_type_id);
 
-    value = std::make_shared<TypedData>(a->getValue()->getType());
+    value = makeIRNode<TypedData>(a.getType());
+    setTypePropagated();
     return true;
 }
 
 Expr::EvalResType MinMaxCallBase::evaluate(yarpgen::EvalCtx &ctx) {
+    if (lookupEvalResult(ctx))
+        return value;
     propagateType();
 
-    EvalResType a_eval_res = a->evaluate(ctx);
-    EvalResType b_eval_res = b->evaluate(ctx);
+    EvalResType a_eval_res = a.evaluate(ctx);
+    EvalResType b_eval_res = b.evaluate(ctx);
 
     if (!a_eval_res->isScalarVar() || !b_eval_res->isScalarVar())
         ERROR("Arguments should be scalar variables");
@@ -3095,15 +3379,16 @@ Expr::EvalResType MinMaxCallBase::evaluate(yarpgen::EvalCtx &ctx) {
     else
         ERROR("Unsupported LibCallKind");
     value = replaceValueWith(
-        value, std::make_shared<ScalarVar>("", a_int_type, res_val));
+        value, makeIRNode<ScalarVar>("", a_int_type, res_val));
 
+    storeEvalResult(ctx);
     return value;
 }
 
-void MinMaxCallBase::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void MinMaxCallBase::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                          size_t offset) {
     Options &options = Options::getInstance();
-    stream << offset;
+    stream.indent(offset);
     if (options.isCXX())
         stream << "std::";
     if (kind == LibCallKind::MAX)
@@ -3113,9 +3398,9 @@ void MinMaxCallBase::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     else
         ERROR("Unsupported LibCallKind");
     stream << "((";
-    a->emit(ctx, stream);
+    a.emit(ctx, stream);
     stream << "), (";
-    b->emit(ctx, stream);
+    b.emit(ctx, stream);
     stream << "))";
 }
 
@@ -3147,7 +3432,7 @@ MinMaxCallBase::createHelper(std::shared_ptr<PopulateCtx> ctx,
             auto new_type = IntegralType::init(
                 new_type_id, expr_int_type->getIsStatic(),
                 expr_int_type->getCVQualifier(), expr_int_type->isUniform());
-            expr = std::make_shared<TypeCastExpr>(expr, new_type, false);
+            expr = makeIRNode<TypeCastExpr>(expr, new_type, false);
         }
     };
 
@@ -3158,16 +3443,16 @@ MinMaxCallBase::createHelper(std::shared_ptr<PopulateCtx> ctx,
     }
 
     if (kind == LibCallKind::MAX)
-        return std::make_shared<MaxCall>(a, b);
+        return makeIRNode<MaxCall>(a, b);
     else if (kind == LibCallKind::MIN)
-        return std::make_shared<MinCall>(a, b);
+        return makeIRNode<MinCall>(a, b);
     else
         ERROR("Unsupported LibCallKind");
 }
 
 void MinMaxCallBase::emitCDefinitionImpl(std::shared_ptr<EmitCtx> ctx,
-                                         std::ostream &stream,
-                                         std::string offset, LibCallKind kind) {
+                                         EmitStream &stream, size_t offset,
+                                         LibCallKind kind) {
     std::string func_name, func_sign;
     if (kind == LibCallKind::MAX) {
         func_name = "max";
@@ -3183,28 +3468,27 @@ void MinMaxCallBase::emitCDefinitionImpl(std::shared_ptr<EmitCtx> ctx,
     stream << "       _a " << func_sign << " _b ? _a : _b; })\n";
 }
 
-SelectCall::SelectCall(std::shared_ptr<Expr> _cond,
-                       std::shared_ptr<Expr> _true_arg,
-                       std::shared_ptr<Expr> _false_arg)
+SelectCall::SelectCall(Operand _cond, Operand _true_arg, Operand _false_arg)
     : cond(std::move(_cond)), true_arg(std::move(_true_arg)),
       false_arg(std::move(_false_arg)) {}
 
 bool SelectCall::propagateType() {
-    cond->propagateType();
-    true_arg->propagateType();
-    false_arg->propagateType();
-
-    auto cond_type = cond->getValue()->getType();
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
+    cond.propagateType();
+    true_arg.propagateType();
+    false_arg.propagateType();
+
+    auto cond_type = cond.getType();
     assert(cond_type->isIntType() && "We support only integral types for now");
     auto cond_int_type = std::static_pointer_cast<IntegralType>(cond_type);
     if (cond_int_type->getIntTypeId() != IntTypeID::BOOL)
-        cond = std::make_shared<TypeCastExpr>(
-            cond,
-            IntegralType::init(IntTypeID::BOOL, cond_type->getIsStatic(),
-                               cond_type->getCVQualifier(),
-                               cond_type->isUniform()),
-            true);
-    IntTypeID top_type_id = getTopIntID({true_arg, false_arg});
+        cond.addImplicitConv(IntegralType::init(
+            IntTypeID::BOOL, cond_type->getIsStatic(),
+            cond_type->getCVQualifier(), cond_type->isUniform()));
+    IntTypeID top_type_id =
+        getTopIntID({true_arg.getType(), false_arg.getType()});
     // TODO: we don't have a variant for bool
     if (top_type_id == IntTypeID::BOOL)
         top_type_id = IntTypeID::INT;
@@ -3217,27 +3501,31 @@ bool SelectCall::propagateType() {
 
     Options &options = Options::getInstance();
     if (options.isISPC()) {
-        bool any_varying = isAnyArgVarying({cond, true_arg, false_arg});
+        bool any_varying = isAnyArgVarying(
+            {cond.getType(), true_arg.getType(), false_arg.getType()});
         if (any_varying) {
             ispcArgPromotion(true_arg);
             ispcArgPromotion(false_arg);
         }
     }
-    value = std::make_shared<TypedData>(true_arg->getValue()->getType());
+    value = makeIRNode<TypedData>(true_arg.getType());
+    setTypePropagated();
     return true;
 }
 
 Expr::EvalResType SelectCall::evaluate(EvalCtx &ctx) {
+    if (lookupEvalResult(ctx))
+        return value;
     propagateType();
-    EvalResType cond_eval = cond->evaluate(ctx);
+    EvalResType cond_eval = cond.evaluate(ctx);
     if (cond_eval->getKind() != DataKind::VAR)
         ERROR("We support only scalar variables");
-    auto cond_var = std::static_pointer_cast<ScalarVar>(cond->getValue());
+    auto cond_var = std::static_pointer_cast<ScalarVar>(cond.getValue());
     bool cond_val = (cond_var->getCurrentValue().castToType(IntTypeID::BOOL))
                         .getValueRef<bool>();
     // TODO: check if select is generated with short-circuit logic
-    EvalResType true_eval_res = true_arg->evaluate(ctx);
-    EvalResType false_eval_res = false_arg->evaluate(ctx);
+    EvalResType true_eval_res = true_arg.evaluate(ctx);
+    EvalResType false_eval_res = false_arg.evaluate(ctx);
     assert(true_eval_res->getKind() == DataKind::VAR &&
            false_eval_res->getKind() == DataKind::VAR &&
            "We support only scalar variables for now");
@@ -3253,24 +3541,26 @@ Expr::EvalResType SelectCall::evaluate(EvalCtx &ctx) {
         value = replaceValueWith(value, true_eval_res);
     else
         value = replaceValueWith(value, false_eval_res);
+    storeEvalResult(ctx);
     return value;
 }
 
 Expr::EvalResType SelectCall::rebuild(EvalCtx &ctx) {
-    cond->rebuild(ctx);
-    true_arg->rebuild(ctx);
-    false_arg->rebuild(ctx);
+    invalidate();
+    cond.rebuild(ctx);
+    true_arg.rebuild(ctx);
+    false_arg.rebuild(ctx);
     return evaluate(ctx);
 }
 
-void SelectCall::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                      std::string offset) {
-    stream << offset << "select((";
-    cond->emit(ctx, stream);
+void SelectCall::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                      size_t offset) {
+    stream.indent(offset) << "select((";
+    cond.emit(ctx, stream);
     stream << "), (";
-    true_arg->emit(ctx, stream);
+    true_arg.emit(ctx, stream);
     stream << "), (";
-    false_arg->emit(ctx, stream);
+    false_arg.emit(ctx, stream);
     stream << "))";
 }
 
@@ -3279,27 +3569,32 @@ SelectCall::create(std::shared_ptr<PopulateCtx> ctx) {
     auto cond = ArithmeticExpr::create(ctx);
     auto true_arg = ArithmeticExpr::create(ctx);
     auto false_arg = ArithmeticExpr::create(ctx);
-    return std::make_shared<SelectCall>(cond, true_arg, false_arg);
+    return makeIRNode<SelectCall>(cond, true_arg, false_arg);
 }
 
-LogicalReductionBase::LogicalReductionBase(std::shared_ptr<Expr> _arg,
-                                           LibCallKind _kind)
+LogicalReductionBase::LogicalReductionBase(Operand _arg, LibCallKind _kind)
     : arg(std::move(_arg)), kind(_kind) {}
 
 bool LogicalReductionBase::propagateType() {
-    arg->propagateType();
-    IntTypeID type_id = getTopIntID({arg});
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
+    arg.propagateType();
+    IntTypeID type_id = getTopIntID({arg.getType()});
     if (type_id != IntTypeID::BOOL)
         cxxArgPromotion(arg, IntTypeID::BOOL);
-    if (!isAnyArgVarying({arg}))
+    if (!isAnyArgVarying({arg.getType()}))
         ispcArgPromotion(arg);
-    value = std::make_shared<TypedData>(IntegralType::init(IntTypeID::BOOL));
+    value = makeIRNode<TypedData>(IntegralType::init(IntTypeID::BOOL));
+    setTypePropagated();
     return true;
 }
 
 Expr::EvalResType LogicalReductionBase::evaluate(EvalCtx &ctx) {
+    if (lookupEvalResult(ctx))
+        return value;
     propagateType();
-    EvalResType arg_eval_res = arg->evaluate(ctx);
+    EvalResType arg_eval_res = arg.evaluate(ctx);
     assert(arg_eval_res->isScalarVar() &&
            "We support only scalar variables at this time");
     IRValue arg_val =
@@ -3317,14 +3612,15 @@ Expr::EvalResType LogicalReductionBase::evaluate(EvalCtx &ctx) {
     if (arg_val.hasUB())
         init_val.setUBCode(arg_val.getUBCode());
     value = replaceValueWith(value,
-                             std::make_shared<ScalarVar>("", type, init_val));
+                             makeIRNode<ScalarVar>("", type, init_val));
 
+    storeEvalResult(ctx);
     return value;
 }
 
 void LogicalReductionBase::emit(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream, std::string offset) {
-    stream << offset;
+                                EmitStream &stream, size_t offset) {
+    stream.indent(offset);
     if (kind == LibCallKind::ANY)
         stream << "any";
     else if (kind == LibCallKind::ALL)
@@ -3334,7 +3630,7 @@ void LogicalReductionBase::emit(std::shared_ptr<EmitCtx> ctx,
     else
         ERROR("Unsupported LibCallKind");
     stream << "((";
-    arg->emit(ctx, stream);
+    arg.emit(ctx, stream);
     stream << "))";
 }
 
@@ -3343,41 +3639,45 @@ LogicalReductionBase::createHelper(std::shared_ptr<PopulateCtx> ctx,
                                    LibCallKind kind) {
     auto arg = ArithmeticExpr::create(std::move(ctx));
     if (kind == LibCallKind::ANY)
-        return std::make_shared<AnyCall>(arg);
+        return makeIRNode<AnyCall>(arg);
     else if (kind == LibCallKind::ALL)
-        return std::make_shared<AllCall>(arg);
+        return makeIRNode<AllCall>(arg);
     else if (kind == LibCallKind::NONE)
-        return std::make_shared<NoneCall>(arg);
+        return makeIRNode<NoneCall>(arg);
     else
         ERROR("Unsupported LibCallKind");
 }
 
-MinMaxEqReductionBase::MinMaxEqReductionBase(std::shared_ptr<Expr> _arg,
-                                             LibCallKind _kind)
+MinMaxEqReductionBase::MinMaxEqReductionBase(Operand _arg, LibCallKind _kind)
     : arg(std::move(_arg)), kind(_kind) {}
 
 bool MinMaxEqReductionBase::propagateType() {
-    arg->propagateType();
-    IntTypeID type_id = getTopIntID({arg});
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
+    arg.propagateType();
+    IntTypeID type_id = getTopIntID({arg.getType()});
     // TODO: we don't have reduce_min/max for small types
     if (type_id < IntTypeID::INT)
         cxxArgPromotion(arg, IntTypeID::INT);
-    if (!isAnyArgVarying({arg}))
+    if (!isAnyArgVarying({arg.getType()}))
         ispcArgPromotion(arg);
-    assert(arg->getValue()->getType()->isIntType() &&
+    assert(arg.getType()->isIntType() &&
            "We support only integer types at this time");
     auto arg_int_type_id =
-        std::static_pointer_cast<IntegralType>(arg->getValue()->getType())
-            ->getIntTypeId();
+        std::static_pointer_cast<IntegralType>(arg.getType())->getIntTypeId();
     arg_int_type_id =
         kind != LibCallKind::RED_EQ ? arg_int_type_id : IntTypeID::BOOL;
-    value = std::make_shared<TypedData>(IntegralType::init(arg_int_type_id));
+    value = makeIRNode<TypedData>(IntegralType::init(arg_int_type_id));
+    setTypePropagated();
     return true;
 }
 
 Expr::EvalResType MinMaxEqReductionBase::evaluate(EvalCtx &ctx) {
+    if (lookupEvalResult(ctx))
+        return value;
     propagateType();
-    EvalResType arg_eval_res = arg->evaluate(ctx);
+    EvalResType arg_eval_res = arg.evaluate(ctx);
     assert(arg_eval_res->isScalarVar() &&
            "We support only scalar variables for now");
     IRValue arg_val =
@@ -3391,7 +3691,7 @@ Expr::EvalResType MinMaxEqReductionBase::evaluate(EvalCtx &ctx) {
             std::static_pointer_cast<IntegralType>(arg_eval_res->getType())
                 ->getIntTypeId();
         value = replaceValueWith(
-            value, std::make_shared<ScalarVar>(
+            value, makeIRNode<ScalarVar>(
                        "", IntegralType::init(ret_int_type_id), arg_val));
     }
     else if (kind == LibCallKind::RED_EQ) {
@@ -3399,18 +3699,19 @@ Expr::EvalResType MinMaxEqReductionBase::evaluate(EvalCtx &ctx) {
         init_val.setValue(IRValue::AbsValue{false, true});
         init_val.setUBCode(arg_val.getUBCode());
         value = replaceValueWith(
-            value, std::make_shared<ScalarVar>(
+            value, makeIRNode<ScalarVar>(
                        "", IntegralType::init(IntTypeID::BOOL), init_val));
     }
     else
         ERROR("Unsupported LibCallKind");
 
+    storeEvalResult(ctx);
     return value;
 }
 
 void MinMaxEqReductionBase::emit(std::shared_ptr<EmitCtx> ctx,
-                                 std::ostream &stream, std::string offset) {
-    stream << offset;
+                                 EmitStream &stream, size_t offset) {
+    stream.indent(offset);
     if (kind == LibCallKind::RED_MIN)
         stream << "reduce_min";
     else if (kind == LibCallKind::RED_MAX)
@@ -3420,7 +3721,7 @@ void MinMaxEqReductionBase::emit(std::shared_ptr<EmitCtx> ctx,
     else
         ERROR("Unsupported LibCallKind");
     stream << "((";
-    arg->emit(ctx, stream);
+    arg.emit(ctx, stream);
     stream << "))";
 }
 
@@ -3429,11 +3730,11 @@ MinMaxEqReductionBase::createHelper(std::shared_ptr<PopulateCtx> ctx,
                                     LibCallKind kind) {
     auto arg = ArithmeticExpr::create(std::move(ctx));
     if (kind == LibCallKind::RED_MIN)
-        return std::make_shared<ReduceMinCall>(arg);
+        return makeIRNode<ReduceMinCall>(arg);
     else if (kind == LibCallKind::RED_MAX)
-        return std::make_shared<ReduceMaxCall>(arg);
+        return makeIRNode<ReduceMaxCall>(arg);
     else if (kind == LibCallKind::RED_EQ)
-        return std::make_shared<ReduceEqCall>(arg);
+        return makeIRNode<ReduceEqCall>(arg);
     else
         ERROR("Unsupported LibCallKind");
 }
@@ -3442,19 +3743,25 @@ ExtractCall::ExtractCall(std::shared_ptr<Expr> _arg)
     : arg(_arg), is_implicit(false) {
     IRValue idx_val(IntTypeID::UINT);
     idx_val.setValue(IRValue::AbsValue{false, 0});
-    idx = std::make_shared<ConstantExpr>(idx_val);
+    idx = makeIRNode<ConstantExpr>(idx_val);
 }
 
 bool ExtractCall::propagateType() {
+    if (isTypePropagated())
+        return true;
+    PhaseTimer timer(GenPhase::PROPAGATE_TYPE);
     arg->propagateType();
     auto arg_int_type_id =
         std::static_pointer_cast<IntegralType>(arg->getValue()->getType())
             ->getIntTypeId();
-    value = std::make_shared<TypedData>(IntegralType::init(arg_int_type_id));
+    value = makeIRNode<TypedData>(IntegralType::init(arg_int_type_id));
+    setTypePropagated();
     return true;
 }
 
 Expr::EvalResType ExtractCall::evaluate(EvalCtx &ctx) {
+    if (lookupEvalResult(ctx))
+        return value;
     propagateType();
     EvalResType arg_eval_res = arg->evaluate(ctx);
     assert(arg_eval_res->isScalarVar() &&
@@ -3467,13 +3774,14 @@ Expr::EvalResType ExtractCall::evaluate(EvalCtx &ctx) {
         std::static_pointer_cast<IntegralType>(arg_eval_res->getType());
     auto ret_type = IntegralType::init(arg_type->getIntTypeId());
     value = replaceValueWith(
-        value, std::make_shared<ScalarVar>("", ret_type, arg_val));
+        value, makeIRNode<ScalarVar>("", ret_type, arg_val));
+    storeEvalResult(ctx);
     return value;
 }
 
-void ExtractCall::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                       std::string offset) {
-    stream << offset;
+void ExtractCall::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                       size_t offset) {
+    stream.indent(offset);
     if (is_implicit)
         stream << "/* implicit */ ";
     stream << "extract";
@@ -3487,5 +3795,5 @@ void ExtractCall::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 std::shared_ptr<LibCallExpr>
 ExtractCall::create(std::shared_ptr<PopulateCtx> ctx) {
     auto arg = ArithmeticExpr::create(std::move(ctx));
-    return std::make_shared<ExtractCall>(arg);
+    return makeIRNode<ExtractCall>(arg);
 }
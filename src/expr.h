@@ -19,10 +19,13 @@ limitations under the License.
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <deque>
 #include <map>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "data.h"
 #include "gen_policy.h"
@@ -35,7 +38,7 @@ class EvalCtx;
 class PopulateCtx;
 
 // Common ancestor for all classes that represent various expressions
-class Expr : public IRNode {
+class Expr : public IRNode, public std::enable_shared_from_this<Expr> {
   public:
     explicit Expr(std::shared_ptr<Data> _value) : value(std::move(_value)) {}
     Expr() = default;
@@ -46,8 +49,8 @@ class Expr : public IRNode {
 
     // This function does type conversions required by the language standard
     // (implicit cast, integral promotion or usual arithmetic conversions) to
-    // existing child nodes. As a result, it inserts required TypeCastExpr
-    // between existing child nodes and current node.
+    // existing child nodes. As a result, it records required implicit
+    // conversions on the operands of the current node (see Operand).
     // TODO: do we care about CV-qualifiers?
     virtual bool propagateType() = 0;
 
@@ -63,13 +66,41 @@ class Expr : public IRNode {
     virtual std::shared_ptr<Data> getValue();
 
     // Deep copy of the expression. We use it to duplicate expressions in
-    // case of UB for multiple values
+    // case of UB for multiple values. Leaf nodes are immutable, so the copies
+    // share them.
     virtual std::shared_ptr<Expr> copy() = 0;
 
+    // Each change of the current value of a variable has to be reported,
+    // because it makes all of the memoized evaluation results obsolete
+    static void invalidateEvalResults() { eval_epoch++; }
+
   protected:
+    // Non-leaf nodes memoize the results of propagateType() and evaluate(),
+    // so the repeated calls cost O(1) unless the subtree was changed.
+    // The evaluation results are memoized separately for the main and the
+    // alternative values. Any change to the node itself (operator or
+    // children) has to be followed by invalidate().
+    bool isTypePropagated() { return type_propagated; }
+    void setTypePropagated() { type_propagated = true; }
+    // Returns true and restores the value if it is memoized for the context
+    bool lookupEvalResult(EvalCtx &ctx);
+    void storeEvalResult(EvalCtx &ctx);
+    void invalidate();
+
     std::shared_ptr<Data> value;
 
   private:
+    struct EvalResult {
+        uint64_t epoch = 0;
+        std::shared_ptr<Data> value;
+    };
+    bool type_propagated = false;
+    // Indexed by EvalCtx::use_main_vals
+    std::array<EvalResult, 2> eval_results;
+    // Generation of the variable values. Evaluation results from the previous
+    // generations are obsolete.
+    static thread_local uint64_t eval_epoch;
+
     // TODO: add complexity tracker
     /*
     uint32_t complexity;
@@ -81,6 +112,39 @@ class Expr : public IRNode {
     */
 };
 
+// Edge from an expression to its child. Implicit conversions that the
+// language standard requires are recorded here as a list of types instead of
+// separate TypeCastExpr nodes, so they don't cost a node each. Evaluation and
+// emission apply them in order, the last one is the outermost. Explicit casts
+// are still represented with TypeCastExpr.
+class Operand {
+  public:
+    Operand() = default;
+    // It is implicit, so any expression can be used as an operand
+    template <typename T>
+    Operand(std::shared_ptr<T> _expr) : expr(std::move(_expr)) {}
+
+    std::shared_ptr<Expr> getExpr() { return expr; }
+    // Type of the operand after all of the conversions
+    std::shared_ptr<Type> getType();
+    // Result of the last evaluation
+    std::shared_ptr<Data> getValue();
+    void addImplicitConv(const std::shared_ptr<Type> &to_type);
+
+    bool propagateType() { return expr->propagateType(); }
+    Expr::EvalResType evaluate(EvalCtx &ctx);
+    Expr::EvalResType rebuild(EvalCtx &ctx);
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream);
+
+    Operand copy();
+
+  private:
+    std::shared_ptr<Expr> expr;
+    std::vector<std::shared_ptr<IntegralType>> implicit_convs;
+    // Converted value. It is used only if there are any conversions.
+    std::shared_ptr<Data> value;
+};
+
 // Constant representation
 class ConstantExpr : public Expr {
   public:
@@ -91,15 +155,12 @@ class ConstantExpr : public Expr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<ConstantExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() final;
-
-  private:
-    static std::vector<std::shared_ptr<ConstantExpr>> used_consts;
 };
 
 // Abstract class that represents access to all sorts of variables
@@ -112,7 +173,7 @@ class VarUseExpr : public Expr {
 class ScalarVarUseExpr : public VarUseExpr {
   public:
     // No one is supposed to call this constructor directly.
-    // It is left public in order to use std::make_shared
+    // It is left public in order to use makeIRNode
     explicit ScalarVarUseExpr(std::shared_ptr<Data> _val)
         : VarUseExpr(std::move(_val)) {}
     static std::shared_ptr<ScalarVarUseExpr> init(std::shared_ptr<Data> _val);
@@ -124,19 +185,14 @@ class ScalarVarUseExpr : public VarUseExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final {
-        stream << offset << value->getName(ctx);
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final {
+        stream.indent(offset) << value->getName(ctx);
     };
     static std::shared_ptr<ScalarVarUseExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() final;
-
-  private:
-    static std::unordered_map<std::shared_ptr<Data>,
-                              std::shared_ptr<ScalarVarUseExpr>>
-        scalar_var_use_set;
 };
 
 class ArrayUseExpr : public VarUseExpr {
@@ -152,17 +208,12 @@ class ArrayUseExpr : public VarUseExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final {
-        stream << offset << value->getName(ctx);
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final {
+        stream.indent(offset) << value->getName(ctx);
     };
 
     std::shared_ptr<Expr> copy() final;
-
-  private:
-    static std::unordered_map<std::shared_ptr<Data>,
-                              std::shared_ptr<ArrayUseExpr>>
-        array_use_set;
 };
 
 class IterUseExpr : public VarUseExpr {
@@ -178,22 +229,17 @@ class IterUseExpr : public VarUseExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final {
-        stream << offset << value->getName(ctx);
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final {
+        stream.indent(offset) << value->getName(ctx);
     };
 
     std::shared_ptr<Expr> copy() final;
-
-  private:
-    static std::unordered_map<std::shared_ptr<Data>,
-                              std::shared_ptr<IterUseExpr>>
-        iter_use_set;
 };
 
 class TypeCastExpr : public Expr {
   public:
-    TypeCastExpr(std::shared_ptr<Expr> _expr, std::shared_ptr<Type> _to_type,
+    TypeCastExpr(Operand _expr, std::shared_ptr<Type> _to_type,
                  bool _is_implicit);
     IRNodeKind getKind() final { return IRNodeKind::TYPE_CAST; }
 
@@ -202,15 +248,17 @@ class TypeCastExpr : public Expr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<TypeCastExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() final;
 
+    std::shared_ptr<Expr> getExpr() { return expr.getExpr(); }
+
   private:
-    std::shared_ptr<Expr> expr;
+    Operand expr;
     std::shared_ptr<Type> to_type;
     bool is_implicit;
 };
@@ -224,77 +272,85 @@ class ArithmeticExpr : public Expr {
     static std::shared_ptr<Expr> create(std::shared_ptr<PopulateCtx> ctx);
 
   protected:
-    static std::shared_ptr<Expr> integralProm(std::shared_ptr<Expr> arg);
-    static std::shared_ptr<Expr> convToBool(std::shared_ptr<Expr> arg);
-    static void arithConv(std::shared_ptr<Expr> &lhs,
-                          std::shared_ptr<Expr> &rhs);
-    static void varyingPromotion(std::shared_ptr<Expr> &lhs,
-                                 std::shared_ptr<Expr> &rhs);
+    static void integralProm(Operand &arg);
+    static void convToBool(Operand &arg);
+    static void arithConv(Operand &lhs, Operand &rhs);
+    static void varyingPromotion(Operand &lhs, Operand &rhs);
 };
 
 class UnaryExpr : public ArithmeticExpr {
   public:
-    UnaryExpr(UnaryOp _op, std::shared_ptr<Expr> _expr);
+    UnaryExpr(UnaryOp _op, Operand _expr);
     IRNodeKind getKind() final { return IRNodeKind::UNARY; }
 
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<UnaryExpr> create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() final;
 
   private:
     UnaryOp op;
-    std::shared_ptr<Expr> arg;
+    Operand arg;
 };
 
 class BinaryExpr : public ArithmeticExpr {
   public:
-    BinaryExpr(BinaryOp _op, std::shared_ptr<Expr> _lhs,
-               std::shared_ptr<Expr> _rhs);
+    BinaryExpr(BinaryOp _op, Operand _lhs, Operand _rhs);
     IRNodeKind getKind() final { return IRNodeKind::BINARY; }
 
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<BinaryExpr> create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() final;
 
+    BinaryOp getOp() { return op; }
+    std::shared_ptr<Expr> getLHS() { return lhs.getExpr(); }
+    std::shared_ptr<Expr> getRHS() { return rhs.getExpr(); }
+
   private:
+    // Eliminates UB in the node itself. The operands have to be free of UB
+    // already, so each fix is chosen from their known values, and they are
+    // never visited again. It keeps the rebuild linear in the tree size.
+    EvalResType repairUB(EvalCtx &ctx);
+    // Changes the operator or the operands, so the node is free of the UB.
+    // The nodes that it creates are repaired right away.
+    void fixUB(UBKind ub, EvalCtx &ctx);
+
     BinaryOp op;
-    std::shared_ptr<Expr> lhs;
-    std::shared_ptr<Expr> rhs;
+    Operand lhs;
+    Operand rhs;
 };
 
 class TernaryExpr : public ArithmeticExpr {
   public:
-    TernaryExpr(std::shared_ptr<Expr> _cond, std::shared_ptr<Expr> _true_br,
-                std::shared_ptr<Expr> _false_br);
+    TernaryExpr(Operand _cond, Operand _true_br, Operand _false_br);
     IRNodeKind getKind() final { return IRNodeKind::TERNARY; }
 
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<TernaryExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() final;
 
   private:
-    std::shared_ptr<Expr> cond;
-    std::shared_ptr<Expr> true_br;
-    std::shared_ptr<Expr> false_br;
+    Operand cond;
+    Operand true_br;
+    Operand false_br;
 };
 
 class ArrayStencilParams;
@@ -305,13 +361,16 @@ class SubscriptExpr : public Expr {
     IRNodeKind getKind() final { return IRNodeKind::SUBSCRIPT; }
 
     size_t getActiveDim() { return active_dim; }
+    std::shared_ptr<Expr> getArrayExpr() { return array; }
+    std::shared_ptr<Expr> getIdxExpr() { return idx; }
+    int64_t getOffset() { return stencil_offset; }
 
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<SubscriptExpr>
     init(std::shared_ptr<Array> arr, std::shared_ptr<PopulateCtx> ctx);
     static std::vector<std::shared_ptr<Array>>
@@ -328,9 +387,12 @@ class SubscriptExpr : public Expr {
     static std::shared_ptr<SubscriptExpr>
     initImpl(ArrayStencilParams array_params, std::shared_ptr<PopulateCtx> ctx);
     bool inBounds(size_t dim, std::shared_ptr<Data> idx_val, EvalCtx &ctx);
+    // Values of the array that the subscript on the axis with multiple values
+    // selects. use_main_vals is the choice of the iterator of the axis.
+    bool iterSelectsMainVals(bool use_main_vals);
+    bool constSelectsMainVals(std::shared_ptr<Data> idx_val);
 
     void setOffset(int64_t _offset) { stencil_offset = _offset; }
-    int64_t getOffset() { return stencil_offset; }
 
     std::shared_ptr<Expr> array;
     std::shared_ptr<Expr> idx;
@@ -358,17 +420,20 @@ class AssignmentExpr : public Expr {
     // after the expression is evaluated and rebuilt.
     virtual void propagateValue(EvalCtx &ctx);
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") override;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) override;
     static std::shared_ptr<AssignmentExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() override;
 
     std::shared_ptr<Expr> getTo() { return to; }
+    bool isTaken() { return taken; }
 
   protected:
     std::shared_ptr<Expr> from;
+    // Expression for the alternative values. It is the same node as "from"
+    // until they need different UB repairs, and only then it is copied.
     // TODO: fold into a single array
     std::shared_ptr<Expr> second_from;
     bool taken;
@@ -391,8 +456,8 @@ class ReductionExpr : public AssignmentExpr {
     EvalResType rebuild(EvalCtx &ctx) final;
     virtual void propagateValue(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<ReductionExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
@@ -427,10 +492,12 @@ class LibCallExpr : public CallExpr {
     // Utility functions to simplify type conversions
     // You should call propagateType on the arguments beforehand
     // CXX conversions should be performed before any other
-    static IntTypeID getTopIntID(std::vector<std::shared_ptr<Expr>> args);
-    static void cxxArgPromotion(std::shared_ptr<Expr> &arg, IntTypeID type_id);
-    static bool isAnyArgVarying(std::vector<std::shared_ptr<Expr>> args);
-    static void ispcArgPromotion(std::shared_ptr<Expr> &arg);
+    static IntTypeID
+    getTopIntID(const std::vector<std::shared_ptr<Type>> &arg_types);
+    static void cxxArgPromotion(Operand &arg, IntTypeID type_id);
+    static bool
+    isAnyArgVarying(const std::vector<std::shared_ptr<Type>> &arg_types);
+    static void ispcArgPromotion(Operand &arg);
 };
 
 class MinMaxCallBase : public LibCallExpr {
@@ -438,88 +505,86 @@ class MinMaxCallBase : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final {
-        a->rebuild(ctx);
-        b->rebuild(ctx);
+        invalidate();
+        a.rebuild(ctx);
+        b.rebuild(ctx);
         return evaluate(ctx);
     }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") override;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) override;
 
   protected:
-    MinMaxCallBase(std::shared_ptr<Expr> _a, std::shared_ptr<Expr> _b,
-                   LibCallKind _kind);
+    MinMaxCallBase(Operand _a, Operand _b, LibCallKind _kind);
     static std::shared_ptr<LibCallExpr>
     createHelper(std::shared_ptr<PopulateCtx> ctx, LibCallKind kind);
     static void emitCDefinitionImpl(std::shared_ptr<EmitCtx> ctx,
-                                    std::ostream &stream, std::string offset,
+                                    EmitStream &stream, size_t offset,
                                     LibCallKind kind);
-    std::shared_ptr<Expr> a;
-    std::shared_ptr<Expr> b;
+    Operand a;
+    Operand b;
     LibCallKind kind;
 };
 
 class MinCall : public MinMaxCallBase {
   public:
-    MinCall(std::shared_ptr<Expr> _a, std::shared_ptr<Expr> _b)
+    MinCall(Operand _a, Operand _b)
         : MinMaxCallBase(std::move(_a), std::move(_b), LibCallKind::MIN) {}
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx) {
         return createHelper(std::move(ctx), LibCallKind::MIN);
     }
     static void emitCDefinition(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream, std::string offset = "") {
+                                EmitStream &stream, size_t offset = 0) {
         emitCDefinitionImpl(ctx, stream, offset, LibCallKind::MAX);
     }
     std::shared_ptr<Expr> copy() final {
-        auto new_a = a->copy();
-        auto new_b = b->copy();
-        return std::make_shared<MinCall>(new_a, new_b);
+        auto new_a = a.copy();
+        auto new_b = b.copy();
+        return makeIRNode<MinCall>(new_a, new_b);
     }
 };
 
 class MaxCall : public MinMaxCallBase {
   public:
-    MaxCall(std::shared_ptr<Expr> _a, std::shared_ptr<Expr> _b)
+    MaxCall(Operand _a, Operand _b)
         : MinMaxCallBase(std::move(_a), std::move(_b), LibCallKind::MAX) {}
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx) {
         return createHelper(std::move(ctx), LibCallKind::MAX);
     }
     static void emitCDefinition(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream, std::string offset = "") {
+                                EmitStream &stream, size_t offset = 0) {
         emitCDefinitionImpl(ctx, stream, offset, LibCallKind::MIN);
     }
     std::shared_ptr<Expr> copy() final {
-        auto new_a = a->copy();
-        auto new_b = b->copy();
-        return std::make_shared<MaxCall>(new_a, new_b);
+        auto new_a = a.copy();
+        auto new_b = b.copy();
+        return makeIRNode<MaxCall>(new_a, new_b);
     }
 };
 
 class SelectCall : public LibCallExpr {
   public:
-    SelectCall(std::shared_ptr<Expr> _cond, std::shared_ptr<Expr> _true_arg,
-               std::shared_ptr<Expr> _false_arg);
+    SelectCall(Operand _cond, Operand _true_arg, Operand _false_arg);
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() final {
-        auto new_cond = cond->copy();
-        auto new_true_arg = true_arg->copy();
-        auto new_false_arg = false_arg->copy();
-        return std::make_shared<SelectCall>(new_cond, new_true_arg,
-                                            new_false_arg);
+        auto new_cond = cond.copy();
+        auto new_true_arg = true_arg.copy();
+        auto new_false_arg = false_arg.copy();
+        return makeIRNode<SelectCall>(new_cond, new_true_arg, new_false_arg);
     }
 
   private:
-    std::shared_ptr<Expr> cond;
-    std::shared_ptr<Expr> true_arg;
-    std::shared_ptr<Expr> false_arg;
+    Operand cond;
+    Operand true_arg;
+    Operand false_arg;
 };
 
 class LogicalReductionBase : public LibCallExpr {
@@ -527,23 +592,24 @@ class LogicalReductionBase : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final {
-        arg->rebuild(ctx);
+        invalidate();
+        arg.rebuild(ctx);
         return evaluate(ctx);
     }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
 
   protected:
-    LogicalReductionBase(std::shared_ptr<Expr> _arg, LibCallKind _kind);
+    LogicalReductionBase(Operand _arg, LibCallKind _kind);
     static std::shared_ptr<LibCallExpr>
     createHelper(std::shared_ptr<PopulateCtx> ctx, LibCallKind kind);
-    std::shared_ptr<Expr> arg;
+    Operand arg;
     LibCallKind kind;
 };
 
 class AnyCall : public LogicalReductionBase {
   public:
-    explicit AnyCall(std::shared_ptr<Expr> _arg)
+    explicit AnyCall(Operand _arg)
         : LogicalReductionBase(std::move(_arg), LibCallKind::ANY) {}
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx) {
@@ -552,14 +618,14 @@ class AnyCall : public LogicalReductionBase {
     }
 
     std::shared_ptr<Expr> copy() final {
-        auto new_arg = arg->copy();
-        return std::make_shared<AnyCall>(new_arg);
+        auto new_arg = arg.copy();
+        return makeIRNode<AnyCall>(new_arg);
     }
 };
 
 class AllCall : public LogicalReductionBase {
   public:
-    explicit AllCall(std::shared_ptr<Expr> _arg)
+    explicit AllCall(Operand _arg)
         : LogicalReductionBase(std::move(_arg), LibCallKind::ALL) {}
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx) {
@@ -567,14 +633,14 @@ class AllCall : public LogicalReductionBase {
                                                   LibCallKind::ALL);
     }
     std::shared_ptr<Expr> copy() final {
-        auto new_arg = arg->copy();
-        return std::make_shared<AllCall>(new_arg);
+        auto new_arg = arg.copy();
+        return makeIRNode<AllCall>(new_arg);
     }
 };
 
 class NoneCall : public LogicalReductionBase {
   public:
-    explicit NoneCall(std::shared_ptr<Expr> _arg)
+    explicit NoneCall(Operand _arg)
         : LogicalReductionBase(std::move(_arg), LibCallKind::NONE) {}
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx) {
@@ -582,8 +648,8 @@ class NoneCall : public LogicalReductionBase {
                                                   LibCallKind::NONE);
     }
     std::shared_ptr<Expr> copy() final {
-        auto new_arg = arg->copy();
-        return std::make_shared<NoneCall>(new_arg);
+        auto new_arg = arg.copy();
+        return makeIRNode<NoneCall>(new_arg);
     }
 };
 
@@ -592,23 +658,24 @@ class MinMaxEqReductionBase : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final {
-        arg->rebuild(ctx);
+        invalidate();
+        arg.rebuild(ctx);
         return evaluate(ctx);
     }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
 
   protected:
-    MinMaxEqReductionBase(std::shared_ptr<Expr> _arg, LibCallKind _kind);
+    MinMaxEqReductionBase(Operand _arg, LibCallKind _kind);
     static std::shared_ptr<LibCallExpr>
     createHelper(std::shared_ptr<PopulateCtx> ctx, LibCallKind kind);
-    std::shared_ptr<Expr> arg;
+    Operand arg;
     LibCallKind kind;
 };
 
 class ReduceMinCall : public MinMaxEqReductionBase {
   public:
-    explicit ReduceMinCall(std::shared_ptr<Expr> _arg)
+    explicit ReduceMinCall(Operand _arg)
         : MinMaxEqReductionBase(std::move(_arg), LibCallKind::RED_MIN) {}
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx) {
@@ -616,14 +683,14 @@ class ReduceMinCall : public MinMaxEqReductionBase {
                                                    LibCallKind::RED_MIN);
     }
     std::shared_ptr<Expr> copy() final {
-        auto new_arg = arg->copy();
-        return std::make_shared<ReduceMinCall>(new_arg);
+        auto new_arg = arg.copy();
+        return makeIRNode<ReduceMinCall>(new_arg);
     }
 };
 
 class ReduceMaxCall : public MinMaxEqReductionBase {
   public:
-    explicit ReduceMaxCall(std::shared_ptr<Expr> _arg)
+    explicit ReduceMaxCall(Operand _arg)
         : MinMaxEqReductionBase(std::move(_arg), LibCallKind::RED_MAX) {}
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx) {
@@ -631,14 +698,14 @@ class ReduceMaxCall : public MinMaxEqReductionBase {
                                                    LibCallKind::RED_MAX);
     }
     std::shared_ptr<Expr> copy() final {
-        auto new_arg = arg->copy();
-        return std::make_shared<ReduceMaxCall>(new_arg);
+        auto new_arg = arg.copy();
+        return makeIRNode<ReduceMaxCall>(new_arg);
     }
 };
 
 class ReduceEqCall : public MinMaxEqReductionBase {
   public:
-    explicit ReduceEqCall(std::shared_ptr<Expr> _arg)
+    explicit ReduceEqCall(Operand _arg)
         : MinMaxEqReductionBase(std::move(_arg), LibCallKind::RED_EQ) {}
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx) {
@@ -646,8 +713,8 @@ class ReduceEqCall : public MinMaxEqReductionBase {
                                                    LibCallKind::RED_EQ);
     }
     std::shared_ptr<Expr> copy() final {
-        auto new_arg = arg->copy();
-        return std::make_shared<ReduceEqCall>(new_arg);
+        auto new_arg = arg.copy();
+        return makeIRNode<ReduceEqCall>(new_arg);
     }
 };
 
@@ -658,17 +725,18 @@ class ExtractCall : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final {
+        invalidate();
         arg->rebuild(ctx);
         return evaluate(ctx);
     };
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Expr> copy() final {
         auto new_arg = arg->copy();
-        return std::make_shared<ExtractCall>(new_arg);
+        return makeIRNode<ExtractCall>(new_arg);
     }
 
     void setIsImplicit(bool _val) { is_implicit = _val; }
@@ -17,13 +17,20 @@ limitations under the License.
 
 #include "gen_policy.h"
 #include "options.h"
+#include "statistics.h"
+
+#include <algorithm>
 
 using namespace yarpgen;
 
 size_t GenPolicy::leaves_prob_bump = 30;
 
+GenPolicy::CopyCounter::CopyCounter(const CopyCounter &) {
+    Statistics::getInstance().addGenPolicyCopy();
+}
+
 template <typename T>
-static void shuffleProbProxy(std::vector<Probability<T>> &vec) {
+static void shuffleProbProxy(ProbDistr<T> &vec) {
     Options &options = Options::getInstance();
     if (!options.getUseParamShuffle())
         return;
@@ -361,16 +368,20 @@ GenPolicy::GenPolicy() {
 
     // Arrays with single dimension require a separate treatment. Otherwise, we
     // do not get the desired distribution.
-    stencil_in_dim_prob.emplace(
+    std::map<size_t, ProbDistr<bool>> new_stencil_in_dim_prob;
+    new_stencil_in_dim_prob.emplace(
         1, std::initializer_list<Probability<bool>>{{true, 80}, {false, 20}});
-    shuffleProbProxy(stencil_in_dim_prob[1]);
+    shuffleProbProxy(new_stencil_in_dim_prob[1]);
     for (size_t i = 2; i <= array_dims_num_limit; i++) {
         size_t gen_prob = (1.0 / i + stencil_in_dim_prob_offset) * 100;
-        stencil_in_dim_prob.emplace(
+        new_stencil_in_dim_prob.emplace(
             i, std::initializer_list<Probability<bool>>{
                    {true, gen_prob}, {false, 100 - gen_prob}});
-        shuffleProbProxy(stencil_in_dim_prob[i]);
+        shuffleProbProxy(new_stencil_in_dim_prob[i]);
     }
+    stencil_in_dim_prob =
+        std::make_shared<const std::map<size_t, ProbDistr<bool>>>(
+            std::move(new_stencil_in_dim_prob));
 
     subs_order_kind_distr.emplace_back(SubscriptOrderKind::IN_ORDER, 40);
     subs_order_kind_distr.emplace_back(SubscriptOrderKind::REVERSE, 20);
@@ -426,7 +437,7 @@ void GenPolicy::makeVectorizable() {
 
     removeProbability(stmt_kind_struct_distr, IRNodeKind::LOOP_NEST);
 
-    max_arith_depth = 3;
+    max_arith_depth = std::min(max_arith_depth, static_cast<size_t>(3));
     removeProbability(arith_node_distr, IRNodeKind::CALL);
 
     loop_end_kind_distr.clear();
@@ -448,6 +459,16 @@ void GenPolicy::makeVectorizable() {
     vectorizable_loop_distr.emplace_back(false, 90);
 }
 
+void GenPolicy::applyBudgetLimits(size_t stmt_num, size_t loop_depth) {
+    stmt_num_lim = std::min(stmt_num_lim, stmt_num);
+    loop_depth_limit = std::min(loop_depth_limit, loop_depth);
+    max_arith_depth = std::min(max_arith_depth, static_cast<size_t>(1));
+    iter_end_limit_max = iters_end_limit_min;
+    array_dims_num_limit =
+        std::min(array_dims_num_limit, static_cast<size_t>(2));
+    budget_limited = true;
+}
+
 size_t yarpgen::GenPolicy::const_buf_size = 10;
 
 void GenPolicy::chooseAndApplySimilarOp() {
@@ -511,7 +532,7 @@ void GenPolicy::chooseAndApplyConstUse() {
     }
     else if (active_const_use == ConstUse::HALF) {
         uint64_t sum = 0;
-        auto &vec = arith_node_distr;
+        auto &vec = arith_node_distr.getMutable();
         std::for_each(vec.begin(), vec.end(),
                       [&](Probability<IRNodeKind> n) { sum += n.getProb(); });
         auto search_func = [](Probability<IRNodeKind> n) -> bool {
@@ -528,15 +549,16 @@ void GenPolicy::chooseAndApplyConstUse() {
 }
 
 template <typename T>
-void GenPolicy::uniformProbFromMax(std::vector<Probability<T>> &distr,
-                                   size_t max_num, size_t min_num) {
-    distr.reserve(max_num - min_num);
+void GenPolicy::uniformProbFromMax(ProbDistr<T> &distr, size_t max_num,
+                                   size_t min_num) {
+    distr.getMutable().reserve(max_num - min_num);
     for (size_t i = min_num; i <= max_num; ++i)
         distr.emplace_back(i, (max_num - i + 1) * 10);
 }
 
 template <class T, class U>
-void GenPolicy::removeProbability(std::vector<Probability<T>> &orig, U id) {
+void GenPolicy::removeProbability(ProbDistr<T> &distr, U id) {
+    auto &orig = distr.getMutable();
     auto new_end = std::remove_if(
         orig.begin(), orig.end(),
         [&id](Probability<T> &elem) -> bool { return elem.getId() == id; });
@@ -30,7 +30,8 @@ int main() {
     auto gen_ctx = std::make_shared<GenCtx>();
     auto scope_stmt = ScopeStmt::generateStructure(gen_ctx);
     auto emit_ctx = std::make_shared<EmitCtx>();
-    scope_stmt->emit(emit_ctx, std::cout);
-    std::cout << std::endl;
+    EmitStream stream;
+    scope_stmt->emit(emit_ctx, stream);
+    std::cout << stream.str() << std::endl;
     return 0;
 }
@@ -19,7 +19,10 @@ limitations under the License.
 
 #pragma once
 
-#include <iostream>
+#include "emit_stream.h"
+
+#include <cstddef>
+#include <memory>
 
 namespace yarpgen {
 
@@ -31,11 +34,12 @@ class IRNode {
     // This method emits internal representation of the test to a contextual
     // form using recursive calls. The callee is responsible for all of the
     // wrapping (e.g., parentheses). The caller is obligated to handle the
-    // offset properly.
+    // offset properly. Offset is the nesting depth, every level is indented
+    // by EmitStream::INDENT_WIDTH spaces.
     // TODO: in the future we might output the same test using different
     // language constructions
-    virtual void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                      std::string offset = "") = 0;
+    virtual void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                      size_t offset = 0) = 0;
     // TODO: make it pure virtual later
     virtual void populate(std::shared_ptr<PopulateCtx> ctx){};
 };
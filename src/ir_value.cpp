@@ -20,6 +20,10 @@ limitations under the License.
 #include "ir_value.h"
 #include "type.h"
 
+#include <array>
+#include <tuple>
+#include <utility>
+
 using namespace yarpgen;
 
 IRValue::IRValue()
@@ -47,6 +51,146 @@ template <> uint32_t &IRValue::getValueRef() { return value.uint_val; }
 template <> int64_t &IRValue::getValueRef() { return value.llong_val; }
 template <> uint64_t &IRValue::getValueRef() { return value.ullong_val; }
 
+//////////////////////////////////////////////////////////////////////////////
+// Dispatch of the operators.
+// Each operator is a template function, parametrized by the underlying C++
+// type. Dispatch tables map IntTypeID to the corresponding instantiation, so a
+// call to the operator is a table lookup and a single indirect call.
+// Shift and cast operators depend on two types, so they use 2-D tables.
+
+using IntValueTypes =
+    std::tuple<TypeBool::value_type, TypeSChar::value_type,
+               TypeUChar::value_type, TypeSShort::value_type,
+               TypeUShort::value_type, TypeSInt::value_type,
+               TypeUInt::value_type, TypeSLLong::value_type,
+               TypeULLong::value_type>;
+static constexpr size_t INT_TYPE_ID_NUM =
+    std::tuple_size<IntValueTypes>::value;
+static_assert(INT_TYPE_ID_NUM ==
+                  static_cast<size_t>(IntTypeID::MAX_INT_TYPE_ID),
+              "Dispatch tables should cover all of the IntTypeIDs");
+
+template <size_t Idx>
+using IntValueType = std::tuple_element_t<Idx, IntValueTypes>;
+
+// Arithmetic operators are defined only for the types after integral promotion
+template <typename T>
+static constexpr bool is_promoted_type = sizeof(T) >= sizeof(int32_t);
+
+using UnaryOperatorFunc = IRValue (*)(IRValue &);
+using BinaryOperatorFunc = IRValue (*)(IRValue &, IRValue &);
+using CastOperatorFunc = IRValue (*)(IntTypeID, IRValue &);
+
+template <typename Func>
+using DispatchTable = std::array<Func, INT_TYPE_ID_NUM>;
+template <typename Func>
+using DispatchTable2D = std::array<DispatchTable<Func>, INT_TYPE_ID_NUM>;
+
+static size_t getDispatchIdx(IntTypeID type_id) {
+    auto idx = static_cast<size_t>(type_id);
+    if (idx >= INT_TYPE_ID_NUM)
+        ERROR(std::string("Bad IntTypeID value: ") + std::to_string(idx));
+    return idx;
+}
+
+static IRValue badUnaryOperator(IRValue &operand) {
+    ERROR(std::string("Bad IntTypeID value: ") +
+          std::to_string(static_cast<int>(operand.getIntTypeID())));
+}
+
+static IRValue badBinaryOperator(IRValue &lhs, IRValue &rhs) {
+    ERROR(std::string("Bad IntTypeID value: ") +
+          std::to_string(static_cast<int>(lhs.getIntTypeID())) + ", " +
+          std::to_string(static_cast<int>(rhs.getIntTypeID())));
+}
+
+// Function templates can't be passed as template arguments, so each operator
+// is wrapped into a getter that we use to instantiate it for the tables.
+#define DispatchGetter(__foo__)                                                \
+    struct __foo__##Getter {                                                   \
+        template <typename... T> static constexpr auto get() {                 \
+            return &__foo__<T...>;                                             \
+        }                                                                      \
+    }
+
+template <typename Getter, typename Func, size_t Idx>
+static constexpr Func getPromotedEntry(Func bad_func) {
+    if constexpr (is_promoted_type<IntValueType<Idx>>)
+        return Getter::template get<IntValueType<Idx>>();
+    else
+        return bad_func;
+}
+
+template <typename Getter, typename Func, size_t... Idx>
+static constexpr DispatchTable<Func>
+makePromotedTable(Func bad_func, std::index_sequence<Idx...>) {
+    return {{getPromotedEntry<Getter, Func, Idx>(bad_func)...}};
+}
+
+template <typename Getter, size_t LhsIdx, size_t RhsIdx>
+static constexpr BinaryOperatorFunc getShiftEntry() {
+    if constexpr (is_promoted_type<IntValueType<LhsIdx>> &&
+                  is_promoted_type<IntValueType<RhsIdx>>)
+        return Getter::template get<IntValueType<LhsIdx>,
+                                    IntValueType<RhsIdx>>();
+    else
+        return badBinaryOperator;
+}
+
+template <typename Getter, size_t LhsIdx, size_t... RhsIdx>
+static constexpr DispatchTable<BinaryOperatorFunc>
+makeShiftRow(std::index_sequence<RhsIdx...>) {
+    return {{getShiftEntry<Getter, LhsIdx, RhsIdx>()...}};
+}
+
+template <typename Getter, size_t... LhsIdx>
+static constexpr DispatchTable2D<BinaryOperatorFunc>
+makeShiftTable(std::index_sequence<LhsIdx...>) {
+    return {{makeShiftRow<Getter, LhsIdx>(
+        std::make_index_sequence<INT_TYPE_ID_NUM>())...}};
+}
+
+template <typename Getter, size_t ToIdx, size_t... FromIdx>
+static constexpr DispatchTable<CastOperatorFunc>
+makeCastRow(std::index_sequence<FromIdx...>) {
+    return {{Getter::template get<IntValueType<ToIdx>,
+                                  IntValueType<FromIdx>>()...}};
+}
+
+template <typename Getter, size_t... ToIdx>
+static constexpr DispatchTable2D<CastOperatorFunc>
+makeCastTable(std::index_sequence<ToIdx...>) {
+    return {{makeCastRow<Getter, ToIdx>(
+        std::make_index_sequence<INT_TYPE_ID_NUM>())...}};
+}
+
+// The majority of operators can be implemented the same way.
+// The only exception if they work only for single type.
+
+#define UnaryOperatorImpl(__foo__)                                             \
+    do {                                                                       \
+        static constexpr auto table = makePromotedTable<__foo__##Getter>(      \
+            UnaryOperatorFunc(badUnaryOperator),                               \
+            std::make_index_sequence<INT_TYPE_ID_NUM>());                      \
+        return table[getDispatchIdx(getIntTypeID())](*this);                   \
+    } while (0)
+
+#define BinaryOperatorImpl(__foo__)                                            \
+    do {                                                                       \
+        static constexpr auto table = makePromotedTable<__foo__##Getter>(      \
+            BinaryOperatorFunc(badBinaryOperator),                             \
+            std::make_index_sequence<INT_TYPE_ID_NUM>());                      \
+        return table[getDispatchIdx(lhs.getIntTypeID())](lhs, rhs);            \
+    } while (0)
+
+#define ShiftOperatorImpl(__foo__)                                             \
+    do {                                                                       \
+        static constexpr auto table = makeShiftTable<__foo__##Getter>(         \
+            std::make_index_sequence<INT_TYPE_ID_NUM>());                      \
+        return table[getDispatchIdx(lhs.getIntTypeID())]                       \
+                    [getDispatchIdx(rhs.getIntTypeID())](lhs, rhs);            \
+    } while (0)
+
 //////////////////////////////////////////////////////////////////////////////
 
 // The idea here is to have a template functions to do all the real work and
@@ -70,6 +214,8 @@ template <typename T> static IRValue minusOperator(IRValue &operand) {
     return ret;
 }
 
+DispatchGetter(minusOperator);
+
 IRValue IRValue::operator-() { UnaryOperatorImpl(minusOperator); }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -98,6 +244,8 @@ template <typename T> static IRValue bitwiseNegationOperator(IRValue &operand) {
     return ret;
 }
 
+DispatchGetter(bitwiseNegationOperator);
+
 IRValue IRValue::operator~() { UnaryOperatorImpl(bitwiseNegationOperator); }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -140,6 +288,8 @@ addOperator(IRValue &lhs, IRValue &rhs) {
     return ret;
 }
 
+DispatchGetter(addOperator);
+
 IRValue yarpgen::operator+(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(addOperator);
 }
@@ -183,6 +333,8 @@ subOperator(IRValue &lhs, IRValue &rhs) {
     return ret;
 }
 
+DispatchGetter(subOperator);
+
 IRValue yarpgen::operator-(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(subOperator);
 }
@@ -275,15 +427,17 @@ mulOperator(IRValue &lhs, IRValue &rhs) {
     return ret;
 }
 
+DispatchGetter(mulOperator);
+
 IRValue yarpgen::operator*(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(mulOperator);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-template <typename T>
+template <typename T, typename Op>
 static typename std::enable_if<std::is_unsigned<T>::value, IRValue>::type
-divModImpl(IRValue &lhs, IRValue &rhs, std::function<T(T &, T &)> op) {
+divModImpl(IRValue &lhs, IRValue &rhs, Op op) {
     if (rhs.getIntTypeID() != lhs.getIntTypeID())
         ERROR("Can perform operation only on IRValues with the same IntTypeID");
 
@@ -299,9 +453,9 @@ divModImpl(IRValue &lhs, IRValue &rhs, std::function<T(T &, T &)> op) {
     return ret;
 }
 
-template <typename T>
+template <typename T, typename Op>
 static typename std::enable_if<!std::is_unsigned<T>::value, IRValue>::type
-divModImpl(IRValue &lhs, IRValue &rhs, std::function<T(T &, T &)> op) {
+divModImpl(IRValue &lhs, IRValue &rhs, Op op) {
     if (rhs.getIntTypeID() != lhs.getIntTypeID())
         ERROR("Can perform operation only on IRValues with the same IntTypeID");
 
@@ -331,6 +485,8 @@ template <typename T> static IRValue divOperator(IRValue &lhs, IRValue &rhs) {
     return divModImpl<T>(lhs, rhs, std::divides<T>());
 }
 
+DispatchGetter(divOperator);
+
 IRValue yarpgen::operator/(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(divOperator);
 }
@@ -339,15 +495,16 @@ template <typename T> static IRValue modOperator(IRValue &lhs, IRValue &rhs) {
     return divModImpl<T>(lhs, rhs, std::modulus<T>());
 }
 
+DispatchGetter(modOperator);
+
 IRValue yarpgen::operator%(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(modOperator);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-template <typename T>
-static IRValue cmpEqImpl(IRValue &lhs, IRValue &rhs,
-                         std::function<T(T &, T &)> op) {
+template <typename T, typename Op>
+static IRValue cmpEqImpl(IRValue &lhs, IRValue &rhs, Op op) {
     if (rhs.getIntTypeID() != lhs.getIntTypeID())
         ERROR("Can perform operation only on IRValues with the same IntTypeID");
 
@@ -363,6 +520,8 @@ template <typename T> static IRValue lessOperator(IRValue &lhs, IRValue &rhs) {
     return cmpEqImpl<T>(lhs, rhs, std::less<T>());
 }
 
+DispatchGetter(lessOperator);
+
 IRValue yarpgen::operator<(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(lessOperator);
 }
@@ -372,6 +531,8 @@ static IRValue greaterOperator(IRValue &lhs, IRValue &rhs) {
     return cmpEqImpl<T>(lhs, rhs, std::greater<T>());
 }
 
+DispatchGetter(greaterOperator);
+
 IRValue yarpgen::operator>(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(greaterOperator);
 }
@@ -381,6 +542,8 @@ static IRValue lessEqualOperator(IRValue &lhs, IRValue &rhs) {
     return cmpEqImpl<T>(lhs, rhs, std::less_equal<T>());
 }
 
+DispatchGetter(lessEqualOperator);
+
 IRValue yarpgen::operator<=(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(lessEqualOperator);
 }
@@ -390,6 +553,8 @@ static IRValue greaterEqualOperator(IRValue &lhs, IRValue &rhs) {
     return cmpEqImpl<T>(lhs, rhs, std::greater_equal<T>());
 }
 
+DispatchGetter(greaterEqualOperator);
+
 IRValue yarpgen::operator>=(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(greaterEqualOperator);
 }
@@ -398,6 +563,8 @@ template <typename T> static IRValue equalOperator(IRValue &lhs, IRValue &rhs) {
     return cmpEqImpl<T>(lhs, rhs, std::equal_to<T>());
 }
 
+DispatchGetter(equalOperator);
+
 IRValue yarpgen::operator==(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(equalOperator);
 }
@@ -407,14 +574,16 @@ static IRValue notEqualOperator(IRValue &lhs, IRValue &rhs) {
     return cmpEqImpl<T>(lhs, rhs, std::not_equal_to<T>());
 }
 
+DispatchGetter(notEqualOperator);
+
 IRValue yarpgen::operator!=(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(notEqualOperator);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static IRValue logicalAndOrImpl(IRValue &lhs, IRValue &rhs,
-                                std::function<bool(bool &, bool &)> op) {
+template <typename Op>
+static IRValue logicalAndOrImpl(IRValue &lhs, IRValue &rhs, Op op) {
     if (rhs.getIntTypeID() != lhs.getIntTypeID())
         ERROR("Can perform operation only on IRValues with the same IntTypeID");
     if (lhs.getIntTypeID() != IntTypeID::BOOL)
@@ -447,9 +616,8 @@ IRValue yarpgen::operator||(IRValue lhs, IRValue rhs) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-template <typename T>
-static IRValue bitwiseAndOrXorImpl(IRValue &lhs, IRValue &rhs,
-                                   std::function<T(T &, T &)> op) {
+template <typename T, typename Op>
+static IRValue bitwiseAndOrXorImpl(IRValue &lhs, IRValue &rhs, Op op) {
     if (rhs.getIntTypeID() != lhs.getIntTypeID())
         ERROR("Can perform operation only on IRValues with the same IntTypeID");
 
@@ -466,6 +634,8 @@ static IRValue bitwiseAndOperator(IRValue &lhs, IRValue &rhs) {
     return bitwiseAndOrXorImpl<T>(lhs, rhs, std::bit_and<T>());
 }
 
+DispatchGetter(bitwiseAndOperator);
+
 IRValue yarpgen::operator&(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(bitwiseAndOperator);
 }
@@ -475,6 +645,8 @@ static IRValue bitwiseOrOperator(IRValue &lhs, IRValue &rhs) {
     return bitwiseAndOrXorImpl<T>(lhs, rhs, std::bit_or<T>());
 }
 
+DispatchGetter(bitwiseOrOperator);
+
 IRValue yarpgen::operator|(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(bitwiseOrOperator);
 }
@@ -484,6 +656,8 @@ static IRValue bitwiseXorOperator(IRValue &lhs, IRValue &rhs) {
     return bitwiseAndOrXorImpl<T>(lhs, rhs, std::bit_xor<T>());
 }
 
+DispatchGetter(bitwiseXorOperator);
+
 IRValue yarpgen::operator^(IRValue lhs, IRValue rhs) {
     BinaryOperatorImpl(bitwiseXorOperator);
 }
@@ -545,6 +719,8 @@ static IRValue leftShiftOperator(IRValue &lhs, IRValue &rhs) {
     return ret;
 }
 
+DispatchGetter(leftShiftOperator);
+
 IRValue yarpgen::operator<<(IRValue lhs, IRValue rhs) {
     ShiftOperatorImpl(leftShiftOperator);
 }
@@ -572,6 +748,8 @@ static IRValue rightShiftOperator(IRValue &lhs, IRValue &rhs) {
     return ret;
 }
 
+DispatchGetter(rightShiftOperator);
+
 IRValue yarpgen::operator>>(IRValue lhs, IRValue rhs) {
     ShiftOperatorImpl(rightShiftOperator);
 }
@@ -586,13 +764,17 @@ static IRValue castOperatorImpl(IntTypeID to_type_id, IRValue &from) {
     return ret;
 }
 
+DispatchGetter(castOperatorImpl);
+
 IRValue IRValue::castToType(IntTypeID to_type_id) {
-    std::function<IRValue(IntTypeID, IRValue &)> func;
-    CastOperatorWrapper(castOperatorImpl);
-    return {func(to_type_id, *this)};
+    static constexpr auto table = makeCastTable<castOperatorImplGetter>(
+        std::make_index_sequence<INT_TYPE_ID_NUM>());
+    return table[getDispatchIdx(to_type_id)][getDispatchIdx(type_id)](
+        to_type_id, *this);
 }
 
-std::ostream &yarpgen::operator<<(std::ostream &out, yarpgen::IRValue &val) {
+template <typename Stream>
+static Stream &printValue(Stream &out, IRValue &val) {
     switch (val.getIntTypeID()) {
         OutOperatorCase(IntTypeID::BOOL, bool);
         OutOperatorCase(IntTypeID::SCHAR, int8_t);
@@ -609,6 +791,14 @@ std::ostream &yarpgen::operator<<(std::ostream &out, yarpgen::IRValue &val) {
     return out;
 }
 
+std::ostream &yarpgen::operator<<(std::ostream &out, yarpgen::IRValue &val) {
+    return printValue(out, val);
+}
+
+EmitStream &yarpgen::operator<<(EmitStream &out, yarpgen::IRValue &val) {
+    return printValue(out, val);
+}
+
 IRValue::AbsValue IRValue::getAbsValue() {
     AbsValue ret{false, 0};
     // TODO: function can be called on value which is undefined and we need
@@ -18,29 +18,150 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 #include "options.h"
 #include "program.h"
+#include "session.h"
+#include "statistics.h"
 #include "utils.h"
 
+#include <deque>
+#include <filesystem>
 #include <iostream>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace yarpgen;
 
-int main(int argc, char *argv[]) {
-    OptionParser::initOptions();
-    OptionParser::parse(argc, argv);
+// Seeds of the batch are split between the workers. Each worker takes seeds
+// from the front of its own queue. When it runs out of work, it steals seeds
+// from the back of the other workers' queues.
+class SeedQueues {
+  public:
+    SeedQueues(const std::vector<uint64_t> &seeds, size_t workers_num)
+        : queues(workers_num), mutexes(workers_num) {
+        size_t chunk = (seeds.size() + workers_num - 1) / workers_num;
+        for (size_t i = 0; i < seeds.size(); ++i)
+            queues.at(i / chunk).push_back(seeds.at(i));
+    }
+
+    bool pop(size_t worker_idx, uint64_t &seed) {
+        {
+            std::lock_guard<std::mutex> lock(mutexes.at(worker_idx));
+            auto &queue = queues.at(worker_idx);
+            if (!queue.empty()) {
+                seed = queue.front();
+                queue.pop_front();
+                return true;
+            }
+        }
+        // Nobody adds new seeds, so empty queues mean that we are done
+        for (size_t i = 1; i < queues.size(); ++i) {
+            size_t victim_idx = (worker_idx + i) % queues.size();
+            std::lock_guard<std::mutex> lock(mutexes.at(victim_idx));
+            auto &queue = queues.at(victim_idx);
+            if (!queue.empty()) {
+                seed = queue.back();
+                queue.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+  private:
+    std::vector<std::deque<uint64_t>> queues;
+    std::vector<std::mutex> mutexes;
+};
+
+// Generates a single test. Each test is generated within its own session, so
+// the tests don't share any state and the result depends only on the seed.
+static void generateTest(uint64_t seed, const std::string &base_out_dir,
+                         bool use_sub_dir) {
+    GenSession session;
+    session.setRandValGen(std::make_shared<RandValGen>(seed));
+    GenSession::setCurrent(&session);
 
     Options &options = Options::getInstance();
-    rand_val_gen = std::make_shared<RandValGen>(options.getSeed());
     options.setSeed(rand_val_gen->getSeed());
+    rand_val_gen->setSeedVersion(options.getSeedVersion());
 
     if (options.getMutationKind() == MutationKind::EXPRS ||
         options.getMutationKind() == MutationKind::ALL) {
         rand_val_gen->setMutationSeed(options.getMutationSeed());
     }
 
+    if (use_sub_dir) {
+        std::string out_dir =
+            base_out_dir + "/S_" + std::to_string(options.getSeed());
+        std::error_code err_code;
+        std::filesystem::create_directories(out_dir, err_code);
+        if (err_code)
+            ERROR("Can't create directory " + out_dir + ": " +
+                  err_code.message());
+        options.setOutDir(out_dir);
+    }
+
     ProgramGenerator new_program;
     new_program.emit();
 
+    if (options.getStats())
+        Statistics::getInstance().dumpToFile(options.getOutDir() +
+                                             "/gen_stats.json");
+
+    GenSession::setCurrent(nullptr);
+}
+
+int main(int argc, char *argv[]) {
+    OptionParser::initOptions();
+    OptionParser::parse(argc, argv);
+
+    Options &options = Options::getInstance();
+    Statistics::setPhaseTimingEnabled(options.getStats());
+    size_t batch_size = options.getBatchSize();
+    std::string base_out_dir = options.getOutDir();
+    bool use_sub_dir = batch_size > 1;
+
+    // Single test with a random seed is left to RandValGen as usual
+    if (batch_size == 1) {
+        generateTest(options.getSeed(), base_out_dir, use_sub_dir);
+        return 0;
+    }
+
+    // We need to know all of the seeds in advance to distribute them
+    uint64_t seed = options.getSeed();
+    if (seed == 0) {
+        std::random_device rd;
+        while (seed == 0)
+            seed = rd();
+    }
+    std::vector<uint64_t> seeds;
+    seeds.reserve(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+        seeds.push_back(seed);
+        // Zero seed is reserved for random
+        if (++seed == 0)
+            ++seed;
+    }
+
+    size_t jobs_num = std::min(options.getJobsNum(), batch_size);
+    if (jobs_num == 1) {
+        for (auto cur_seed : seeds)
+            generateTest(cur_seed, base_out_dir, use_sub_dir);
+        return 0;
+    }
+
+    SeedQueues seed_queues(seeds, jobs_num);
+    std::vector<std::thread> workers;
+    workers.reserve(jobs_num);
+    for (size_t i = 0; i < jobs_num; ++i)
+        workers.emplace_back([&seed_queues, &base_out_dir, use_sub_dir, i]() {
+            uint64_t cur_seed = 0;
+            while (seed_queues.pop(i, cur_seed))
+                generateTest(cur_seed, base_out_dir, use_sub_dir);
+        });
+    for (auto &worker : workers)
+        worker.join();
+
     return 0;
 }
@@ -0,0 +1,287 @@
+/*
+Copyright (c) 2019-2020, Intel Corporation
+Copyright (c) 2019-2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Micro-benchmarks for the hot primitives of the generator.
+// Usage: micro_bench [iterations multiplier]
+
+#include "expr.h"
+#include "ir_value.h"
+#include "session.h"
+#include "type.h"
+#include "utils.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace yarpgen;
+
+static const size_t VALS_NUM = 1024;
+static const size_t BASE_ITERS_NUM = 1 << 20;
+
+static size_t iters_mul = 1;
+// Results are accumulated here, so the compiler can't throw away the work
+static volatile uint64_t sink;
+
+// Runs func(iters_num) and reports the average time per iteration
+template <typename F>
+static void runBench(const std::string &name, size_t iters_num, F func) {
+    iters_num *= iters_mul;
+    auto start = std::chrono::steady_clock::now();
+    func(iters_num);
+    auto end = std::chrono::steady_clock::now();
+    double ns =
+        std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << std::left << std::setw(40) << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(2)
+              << ns / static_cast<double>(iters_num) << " ns/iter"
+              << std::endl;
+}
+
+static std::string typeName(IntTypeID type_id) {
+    static const std::vector<std::string> names = {
+        "bool", "schar", "uchar", "short", "ushort",
+        "int",  "uint",  "llong", "ullong"};
+    return names.at(static_cast<size_t>(type_id));
+}
+
+static std::vector<IRValue> genValues(IntTypeID type_id, uint64_t seed,
+                                      bool small) {
+    std::mt19937_64 gen(seed);
+    std::vector<IRValue> ret;
+    ret.reserve(VALS_NUM);
+    for (size_t i = 0; i < VALS_NUM; ++i) {
+        // Small values are used as the second operand to keep UB rare
+        uint64_t val = small ? gen() % 16 + 1 : gen() % (1ULL << 15);
+        ret.emplace_back(type_id, IRValue::AbsValue{false, val});
+    }
+    return ret;
+}
+
+static void benchIRValueOperators() {
+    std::vector<IntTypeID> types = {IntTypeID::INT, IntTypeID::UINT,
+                                    IntTypeID::LLONG, IntTypeID::ULLONG};
+    using BinaryOperator = IRValue (*)(IRValue, IRValue);
+    std::vector<std::pair<std::string, BinaryOperator>> operators = {
+        {"+", [](IRValue a, IRValue b) { return a + b; }},
+        {"-", [](IRValue a, IRValue b) { return a - b; }},
+        {"*", [](IRValue a, IRValue b) { return a * b; }},
+        {"/", [](IRValue a, IRValue b) { return a / b; }},
+        {"%", [](IRValue a, IRValue b) { return a % b; }},
+        {"<", [](IRValue a, IRValue b) { return a < b; }},
+        {"==", [](IRValue a, IRValue b) { return a == b; }},
+        {"&", [](IRValue a, IRValue b) { return a & b; }},
+        {"^", [](IRValue a, IRValue b) { return a ^ b; }},
+        {"<<", [](IRValue a, IRValue b) { return a << b; }},
+        {">>", [](IRValue a, IRValue b) { return a >> b; }}};
+
+    for (auto type_id : types) {
+        auto lhs = genValues(type_id, 1, false);
+        auto rhs = genValues(type_id, 2, true);
+        for (auto &op : operators) {
+            auto foo = op.second;
+            runBench("IRValue " + typeName(type_id) + " " + op.first,
+                     BASE_ITERS_NUM, [&lhs, &rhs, foo](size_t iters_num) {
+                         uint64_t acc = 0;
+                         for (size_t i = 0; i < iters_num; ++i) {
+                             IRValue res = foo(lhs[i % VALS_NUM],
+                                               rhs[(i * 7) % VALS_NUM]);
+                             acc += res.getAbsValue().value;
+                         }
+                         sink = acc;
+                     });
+        }
+    }
+}
+
+static void benchIRValueCasts() {
+    for (auto from_id = IntTypeID::BOOL; from_id < IntTypeID::MAX_INT_TYPE_ID;
+         from_id = static_cast<IntTypeID>(static_cast<int>(from_id) + 1)) {
+        auto vals = genValues(from_id, 3, false);
+        for (auto to_id = IntTypeID::BOOL; to_id < IntTypeID::MAX_INT_TYPE_ID;
+             to_id = static_cast<IntTypeID>(static_cast<int>(to_id) + 1)) {
+            runBench("IRValue cast " + typeName(from_id) + " -> " +
+                         typeName(to_id),
+                     BASE_ITERS_NUM / 4, [&vals, to_id](size_t iters_num) {
+                         uint64_t acc = 0;
+                         for (size_t i = 0; i < iters_num; ++i)
+                             acc += vals[i % VALS_NUM]
+                                        .castToType(to_id)
+                                        .getAbsValue()
+                                        .value;
+                         sink = acc;
+                     });
+        }
+    }
+}
+
+static void benchRandValGen() {
+    std::vector<Probability<int>> prob_vec;
+    for (int i = 0; i < 10; ++i)
+        prob_vec.emplace_back(i, 10 + i * 5);
+    ProbDistr<int> distr(prob_vec);
+    std::vector<int> elems(VALS_NUM);
+    for (size_t i = 0; i < VALS_NUM; ++i)
+        elems[i] = static_cast<int>(i);
+
+    for (auto seed_version : {SeedVersion::V1, SeedVersion::V2}) {
+        rand_val_gen->setSeedVersion(seed_version);
+        std::string suffix =
+            seed_version == SeedVersion::V1 ? " (seed v1)" : " (seed v2)";
+        runBench("RandValGen getRandId vector" + suffix, BASE_ITERS_NUM / 4,
+                 [&prob_vec](size_t iters_num) {
+                     uint64_t acc = 0;
+                     for (size_t i = 0; i < iters_num; ++i)
+                         acc += rand_val_gen->getRandId(prob_vec);
+                     sink = acc;
+                 });
+        runBench("RandValGen getRandId ProbDistr" + suffix, BASE_ITERS_NUM,
+                 [&distr](size_t iters_num) {
+                     uint64_t acc = 0;
+                     for (size_t i = 0; i < iters_num; ++i)
+                         acc += rand_val_gen->getRandId(distr);
+                     sink = acc;
+                 });
+    }
+    rand_val_gen->setSeedVersion(SeedVersion::V1);
+
+    runBench("RandValGen getRandElem", BASE_ITERS_NUM,
+             [&elems](size_t iters_num) {
+                 uint64_t acc = 0;
+                 for (size_t i = 0; i < iters_num; ++i)
+                     acc += rand_val_gen->getRandElem(elems);
+                 sink = acc;
+             });
+    // Includes the copy of the vector, because shuffleProb modifies it
+    runBench("RandValGen shuffleProb", BASE_ITERS_NUM / 64,
+             [&prob_vec](size_t iters_num) {
+                 uint64_t acc = 0;
+                 for (size_t i = 0; i < iters_num; ++i) {
+                     auto vec = prob_vec;
+                     rand_val_gen->shuffleProb(vec);
+                     acc += vec.front().getProb();
+                 }
+                 sink = acc;
+             });
+}
+
+// Lookups of the types that are already in the folding sets of the session
+static void benchTypeInterning() {
+    std::vector<CVQualifier> cv_quals = {CVQualifier::NONE, CVQualifier::CONST,
+                                         CVQualifier::VOLAT,
+                                         CVQualifier::CONST_VOLAT};
+    auto int_types_num = static_cast<size_t>(IntTypeID::MAX_INT_TYPE_ID);
+    runBench("IntegralType init", BASE_ITERS_NUM,
+             [&cv_quals, int_types_num](size_t iters_num) {
+                 uint64_t acc = 0;
+                 for (size_t i = 0; i < iters_num; ++i) {
+                     auto type = IntegralType::init(
+                         static_cast<IntTypeID>(i % int_types_num),
+                         (i / int_types_num) % 2, cv_quals[(i / 2) % 4]);
+                     acc += reinterpret_cast<uintptr_t>(type.get());
+                 }
+                 sink = acc;
+             });
+
+    static const size_t ARRAY_TYPES_NUM = 64;
+    std::vector<std::vector<size_t>> dims_set;
+    for (size_t i = 0; i < ARRAY_TYPES_NUM; ++i) {
+        std::vector<size_t> dims;
+        for (size_t j = 0; j <= i % 4; ++j)
+            dims.push_back(10 + (i * 7 + j * 13) % 30);
+        dims_set.push_back(dims);
+    }
+    std::vector<std::shared_ptr<Type>> base_types;
+    for (size_t i = 0; i < int_types_num; ++i)
+        base_types.push_back(IntegralType::init(static_cast<IntTypeID>(i)));
+    // Populate the folding set, so the benchmark measures the lookups only
+    for (auto &base_type : base_types)
+        for (auto &dims : dims_set)
+            ArrayType::init(base_type, dims);
+
+    runBench("ArrayType init", BASE_ITERS_NUM / 4,
+             [&base_types, &dims_set](size_t iters_num) {
+                 uint64_t acc = 0;
+                 for (size_t i = 0; i < iters_num; ++i) {
+                     auto type =
+                         ArrayType::init(base_types[i % base_types.size()],
+                                         dims_set[(i / 3) % dims_set.size()]);
+                     acc += type->getUID();
+                 }
+                 sink = acc;
+             });
+}
+
+// Builds a complete binary tree of arithmetic expressions
+static std::shared_ptr<Expr> genExprTree(size_t depth, size_t &leaf_idx) {
+    if (depth == 0) {
+        auto val = IRValue(IntTypeID::INT,
+                           IRValue::AbsValue{false, leaf_idx++ % 100});
+        return makeIRNode<ConstantExpr>(val);
+    }
+    auto lhs = genExprTree(depth - 1, leaf_idx);
+    auto rhs = genExprTree(depth - 1, leaf_idx);
+    std::shared_ptr<Expr> ret = makeIRNode<BinaryExpr>(
+        depth % 2 ? BinaryOp::ADD : BinaryOp::BIT_XOR, lhs, rhs);
+    if (depth % 3 == 0)
+        ret = makeIRNode<UnaryExpr>(UnaryOp::NEGATE, ret);
+    return ret;
+}
+
+static void benchExprCopy() {
+    for (size_t depth : {4, 8, 12}) {
+        size_t leaf_idx = 0;
+        auto tree = genExprTree(depth, leaf_idx);
+        runBench("Expr copy depth " + std::to_string(depth),
+                 (BASE_ITERS_NUM >> depth) + 1, [&tree](size_t iters_num) {
+                     uint64_t acc = 0;
+                     for (size_t i = 0; i < iters_num; ++i)
+                         acc += static_cast<uint64_t>(tree->copy()->getKind());
+                     sink = acc;
+                 });
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        std::stringstream arg_ss(argv[1]);
+        arg_ss >> iters_mul;
+        if (iters_mul == 0)
+            ERROR("Iterations multiplier should be a positive number");
+    }
+
+    // The seed is fixed, so all of the runs measure the same choices
+    GenSession session;
+    session.setRandValGen(std::make_shared<RandValGen>(1));
+    GenSession::setCurrent(&session);
+
+    benchIRValueOperators();
+    benchIRValueCasts();
+    benchRandValGen();
+    benchTypeInterning();
+    benchExprCopy();
+
+    GenSession::setCurrent(nullptr);
+    return 0;
+}
@@ -18,6 +18,7 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 
 #include "options.h"
+#include "session.h"
 #include "utils.h"
 #include <cstring>
 #include <functional>
@@ -94,7 +95,7 @@ std::vector<OptionDescr> yarpgen::OptionParser::options_set{
      "Can't parse check algo",
      OptionParser::parseCheckAlgo,
      "hash",
-     {"hash", "asserts"}},
+     {"hash", "asserts", "precompute", "lanes-hash", "lanes-precompute"}},
     {OptionKind::INP_AS_ARGS,
      "",
      "--inp-as-args",
@@ -204,6 +205,126 @@ std::vector<OptionDescr> yarpgen::OptionParser::options_set{
      OptionParser::parseAllowUBInDC,
      "none",
      {"none", "some", "all"}},
+    {OptionKind::BATCH,
+     "",
+     "--batch",
+     true,
+     "Number of tests to generate with consecutive seeds. If it is greater "
+     "than one, each test is placed into its own S_<seed> sub-folder of the "
+     "output folder",
+     "Can't parse batch size",
+     OptionParser::parseBatch,
+     "1",
+     {}},
+    {OptionKind::JOBS,
+     "-j",
+     "--jobs",
+     true,
+     "Number of threads that generate tests of the batch",
+     "Can't parse number of jobs",
+     OptionParser::parseJobs,
+     "1",
+     {}},
+    {OptionKind::SEED_VERSION,
+     "",
+     "--seed-version",
+     true,
+     "Version of the algorithms that make random choices. The same seed "
+     "produces the same test only with the same version. Version 2 samples "
+     "the distributions with integer alias tables and creates reductions in "
+     "iteration spaces of any size",
+     "Can't parse seed version",
+     OptionParser::parseSeedVersion,
+     "1",
+     {"1", "2"}},
+    {OptionKind::COMPACT_DRIVER,
+     "",
+     "--compact-driver",
+     true,
+     "Describe arrays of the driver with a table that is processed by a "
+     "generic code, so the driver build time doesn't depend on them",
+     "Can't parse compact driver",
+     OptionParser::parseCompactDriver,
+     "false",
+     {"true", "false"}},
+    {OptionKind::STATS,
+     "",
+     "--stats",
+     true,
+     "Write the statistics of the generation (time of each phase and "
+     "counters) to gen_stats.json in the output directory",
+     "Can't parse stats",
+     OptionParser::parseStats,
+     "false",
+     {"true", "false"}},
+    {OptionKind::MAX_GEN_TIME,
+     "",
+     "--max-gen-time",
+     true,
+     "Time budget of the generation (in seconds). When the generator nears "
+     "it, the rest of the test is generated with a reduced policy. The test "
+     "depends on the speed of the machine, so the header records the "
+     "--budget-trip-point that reproduces it. Zero means no limit",
+     "Can't parse max generation time",
+     OptionParser::parseMaxGenTime,
+     "0",
+     {}},
+    {OptionKind::BUDGET_TRIP_POINT,
+     "",
+     "--budget-trip-point",
+     true,
+     "Number of the budget check at which the time budget is considered to "
+     "be reached. It replaces --max-gen-time, so the test doesn't depend on "
+     "the machine. Zero means none",
+     "Can't parse budget trip point",
+     OptionParser::parseBudgetTripPoint,
+     "0",
+     {}},
+    {OptionKind::MAX_GEN_MEM,
+     "",
+     "--max-gen-mem",
+     true,
+     "Memory budget of the live IR (in megabytes). When the generator nears "
+     "it, the rest of the test is generated with a reduced policy. Zero means "
+     "no limit",
+     "Can't parse max generation memory",
+     OptionParser::parseMaxGenMem,
+     "0",
+     {}},
+    {OptionKind::MAX_DYN_OPS,
+     "",
+     "--max-dyn-ops",
+     true,
+     "Budget of the estimated number of operations that the test executes. "
+     "When the generator nears it, the rest of the test is generated with a "
+     "reduced policy. Zero means no limit",
+     "Can't parse max dynamic operations",
+     OptionParser::parseMaxDynOps,
+     "0",
+     {}},
+    {OptionKind::MAX_COMPILE_COST,
+     "",
+     "--max-compile-cost",
+     true,
+     "Budget of the estimated compile cost of the test (see "
+     "scripts/calibrate_compile_cost.py). When the generator nears it, the "
+     "rest of the test is generated with a reduced policy. Zero means no "
+     "limit",
+     "Can't parse max compile cost",
+     OptionParser::parseMaxCompileCost,
+     "0",
+     {}},
+    {OptionKind::VALS_NUMBER,
+     "",
+     "--vals-number",
+     true,
+     "Period of the multiple values in loops. The main values are used at "
+     "the indices that are divisible by it, and the alternative values at "
+     "the rest of them",
+     "Can't parse vals number",
+     OptionParser::parseValsNumber,
+     "2",
+     {"2", "4", "8", "16"}},
 };
 
 static void dumpVersion(std::ostream &stream) {
@@ -381,6 +502,12 @@ void OptionParser::parseCheckAlgo(std::string val) {
         options.setCheckAlgo(CheckAlgo::HASH);
     else if (val == "asserts")
         options.setCheckAlgo(CheckAlgo::ASSERTS);
+    else if (val == "precompute")
+        options.setCheckAlgo(CheckAlgo::PRECOMPUTE);
+    else if (val == "lanes-hash")
+        options.setCheckAlgo(CheckAlgo::LANES_HASH);
+    else if (val == "lanes-precompute")
+        options.setCheckAlgo(CheckAlgo::LANES_PRECOMPUTE);
     else
         printHelpAndExit("Can't recognize checking algorithm");
 }
@@ -513,9 +640,120 @@ void OptionParser::parseAllowUBInDC(std::string allow_ub_in_dc_str) {
         printHelpAndExit("Can't recognize input as arguments use level");
 }
 
+void OptionParser::parseBatch(std::string batch_str) {
+    std::stringstream arg_ss(batch_str);
+    Options &options = Options::getInstance();
+    size_t batch_size = 0;
+    arg_ss >> batch_size;
+    if (batch_size == 0)
+        printHelpAndExit("Batch size should be a positive number");
+    options.setBatchSize(batch_size);
+}
+
+void OptionParser::parseJobs(std::string jobs_str) {
+    std::stringstream arg_ss(jobs_str);
+    Options &options = Options::getInstance();
+    size_t jobs_num = 0;
+    arg_ss >> jobs_num;
+    if (jobs_num == 0)
+        printHelpAndExit("Number of jobs should be a positive number");
+    options.setJobsNum(jobs_num);
+}
+
+void OptionParser::parseSeedVersion(std::string val) {
+    Options &options = Options::getInstance();
+    if (val == "1")
+        options.setSeedVersion(SeedVersion::V1);
+    else if (val == "2")
+        options.setSeedVersion(SeedVersion::V2);
+    else
+        printHelpAndExit("Can't recognize seed version");
+}
+
+void OptionParser::parseCompactDriver(std::string val) {
+    Options &options = Options::getInstance();
+    if (val == "true")
+        options.setCompactDriver(true);
+    else if (val == "false")
+        options.setCompactDriver(false);
+    else
+        printHelpAndExit("Can't recognize compact driver");
+}
+
+void OptionParser::parseStats(std::string val) {
+    Options &options = Options::getInstance();
+    if (val == "true")
+        options.setStats(true);
+    else if (val == "false")
+        options.setStats(false);
+    else
+        printHelpAndExit("Can't recognize stats");
+}
+
+void OptionParser::parseMaxGenTime(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    size_t max_gen_time = 0;
+    if (!(arg_ss >> max_gen_time))
+        printHelpAndExit("Can't parse max generation time");
+    options.setMaxGenTime(max_gen_time);
+}
+
+void OptionParser::parseBudgetTripPoint(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    size_t budget_trip_point = 0;
+    if (!(arg_ss >> budget_trip_point))
+        printHelpAndExit("Can't parse budget trip point");
+    options.setBudgetTripPoint(budget_trip_point);
+}
+
+void OptionParser::parseMaxGenMem(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    size_t max_gen_mem = 0;
+    if (!(arg_ss >> max_gen_mem))
+        printHelpAndExit("Can't parse max generation memory");
+    options.setMaxGenMem(max_gen_mem);
+}
+
+void OptionParser::parseMaxDynOps(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    uint64_t max_dyn_ops = 0;
+    if (!(arg_ss >> max_dyn_ops))
+        printHelpAndExit("Can't parse max dynamic operations");
+    options.setMaxDynOps(max_dyn_ops);
+}
+
+void OptionParser::parseMaxCompileCost(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    uint64_t max_compile_cost = 0;
+    if (!(arg_ss >> max_compile_cost))
+        printHelpAndExit("Can't parse max compile cost");
+    options.setMaxCompileCost(max_compile_cost);
+}
+
+void OptionParser::parseValsNumber(std::string val) {
+    Options &options = Options::getInstance();
+    if (val == "2" || val == "4" || val == "8" || val == "16")
+        options.setValsNumber(std::stoul(val));
+    else
+        printHelpAndExit("Vals number should be 2, 4, 8 or 16");
+}
+
+Options &Options::getInstance() {
+    return GenSession::getCurrent().getOptions();
+}
+
 void Options::dump(std::ostream &stream) {
     dumpVersion(stream);
     stream << "Seed: " << seed << "\n";
+    // The default version is implied, so the old headers stay the same
+    if (seed_version != SeedVersion::V1)
+        stream << "Seed version: " << static_cast<int>(seed_version) + 1
+               << "\n";
     stream << "Invocation:";
     for (const auto &option : raw_options) {
         stream << " " << option;
@@ -99,22 +99,34 @@ class OptionParser {
     static void parseMutationKind(std::string mutate_str);
     static void parseMutationSeed(std::string mutation_seed_str);
     static void parseAllowUBInDC(std::string allow_ub_in_dc_str);
+    static void parseBatch(std::string batch_str);
+    static void parseJobs(std::string jobs_str);
+    static void parseSeedVersion(std::string val);
+    static void parseCompactDriver(std::string val);
+    static void parseStats(std::string val);
+    static void parseMaxGenTime(std::string val);
+    static void parseBudgetTripPoint(std::string val);
+    static void parseMaxGenMem(std::string val);
+    static void parseMaxDynOps(std::string val);
+    static void parseMaxCompileCost(std::string val);
+    static void parseValsNumber(std::string val);
 };
 
 class Options {
   public:
-    // The number of divergent values that we support in loops
-    // In theory, it can be made higher, but we assume that 2 is enough
-    // for now. The agreement that main values are tied to the 0-th index
-    static size_t constexpr vals_number = 2;
+    // The number of divergent values that we support in loops. The main
+    // values are tied to the 0-th index, and the alternative values to the
+    // rest of them, so the data always holds two kinds of values (see
+    // getValsNumber() for the period of the pattern).
+    static size_t constexpr val_kinds_num = 2;
     static size_t constexpr main_val_idx = 0;
     static size_t constexpr alt_val_idx = 1;
+    // The number of lanes of the hash for LANES_* check algorithms. It has to
+    // be the same in the driver and in the hash pre-computation.
+    static size_t constexpr hash_lanes_num = 8;
 
-    static Options &getInstance() {
-        static Options instance;
-        return instance;
-    }
-    Options(const Options &options) = delete;
+    // Options of the generation session that is active in the current thread
+    static Options &getInstance();
     Options &operator=(const Options &) = delete;
 
     void setRawOptions(size_t argc, char *argv[]);
@@ -131,6 +143,15 @@ class Options {
 
     void setCheckAlgo(CheckAlgo val) { check_algo = val; }
     CheckAlgo getCheckAlgo() { return check_algo; }
+    bool useHashCheck() { return check_algo != CheckAlgo::ASSERTS; }
+    bool useLanesHash() {
+        return check_algo == CheckAlgo::LANES_HASH ||
+               check_algo == CheckAlgo::LANES_PRECOMPUTE;
+    }
+    bool usePrecomputedHash() {
+        return check_algo == CheckAlgo::PRECOMPUTE ||
+               check_algo == CheckAlgo::LANES_PRECOMPUTE;
+    }
 
     void setInpAsArgs(OptionLevel val) { inp_as_args = val; }
     OptionLevel inpAsArgs() { return inp_as_args; }
@@ -168,9 +189,40 @@ class Options {
     void setAllowUBInDC(OptionLevel _val) { allow_ub_in_dc = _val; }
     OptionLevel getAllowUBInDC() { return allow_ub_in_dc; }
 
+    void setBatchSize(size_t val) { batch_size = val; }
+    size_t getBatchSize() { return batch_size; }
+
+    void setJobsNum(size_t val) { jobs_num = val; }
+    size_t getJobsNum() { return jobs_num; }
+
+    void setSeedVersion(SeedVersion val) { seed_version = val; }
+    SeedVersion getSeedVersion() { return seed_version; }
+
+    void setCompactDriver(bool val) { compact_driver = val; }
+    bool getCompactDriver() { return compact_driver; }
+
+    void setStats(bool val) { stats = val; }
+    bool getStats() { return stats; }
+
+    void setMaxGenTime(size_t val) { max_gen_time = val; }
+    size_t getMaxGenTime() { return max_gen_time; }
+    void setBudgetTripPoint(size_t val) { budget_trip_point = val; }
+    size_t getBudgetTripPoint() { return budget_trip_point; }
+    void setMaxGenMem(size_t val) { max_gen_mem = val; }
+    size_t getMaxGenMem() { return max_gen_mem; }
+    void setMaxDynOps(uint64_t val) { max_dyn_ops = val; }
+    uint64_t getMaxDynOps() { return max_dyn_ops; }
+    void setMaxCompileCost(uint64_t val) { max_compile_cost = val; }
+    uint64_t getMaxCompileCost() { return max_compile_cost; }
+
+    void setValsNumber(size_t val) { vals_number = val; }
+    size_t getValsNumber() { return vals_number; }
+
     void dump(std::ostream &stream);
 
   private:
+    friend class GenSession;
+    Options(const Options &options) = default;
     Options()
         : seed(0), std(LangStd::CXX), check_algo(CheckAlgo::HASH),
           inp_as_args(OptionLevel::SOME), emit_align_attr(OptionLevel::SOME),
@@ -179,7 +231,10 @@ class Options {
           emit_pragmas(OptionLevel::SOME), out_dir("."),
           use_param_shuffle(false), expl_loop_params(false),
           mutation_kind(MutationKind::NONE), mutation_seed(0),
-          allow_ub_in_dc(OptionLevel::NONE) {}
+          allow_ub_in_dc(OptionLevel::NONE), batch_size(1), jobs_num(1),
+          seed_version(SeedVersion::V1), compact_driver(false), stats(false),
+          max_gen_time(0), budget_trip_point(0), max_gen_mem(0),
+          max_dyn_ops(0), max_compile_cost(0), vals_number(2) {}
 
     std::vector<std::string> raw_options;
 
@@ -210,5 +265,36 @@ class Options {
 
     // If we want to allow Undefined Behavior in Dead Code
     OptionLevel allow_ub_in_dc;
+
+    // The number of tests that we generate in a single invocation
+    size_t batch_size;
+    // The number of threads that generate tests of the batch
+    size_t jobs_num;
+
+    SeedVersion seed_version;
+
+    // Initialize and check the arrays in the driver with a generic code that
+    // is driven by a table instead of the loops for each of them
+    bool compact_driver;
+
+    // Dump the statistics of the generation
+    bool stats;
+
+    // Budget of the generation: time in seconds and memory of the IR in
+    // megabytes. Zero means no limit.
+    size_t max_gen_time;
+    // Budget check at which the time budget was reached in the original run.
+    // It replaces the time budget to reproduce the test. Zero means none.
+    size_t budget_trip_point;
+    size_t max_gen_mem;
+    // Budget of the estimated number of operations that the test executes
+    uint64_t max_dyn_ops;
+    // Budget of the estimated compile cost of the test
+    uint64_t max_compile_cost;
+
+    // Period of the multiple values along the axis of an array: the index is
+    // taken modulo it to choose between the main and the alternative values.
+    // Wider periods leave fewer active lanes in the masked vector code.
+    size_t vals_number;
 };
 } // namespace yarpgen
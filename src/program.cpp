@@ -19,16 +19,21 @@ limitations under the License.
 #include "data.h"
 #include "emit_policy.h"
 #include "stmt.h"
-#include <fstream>
 #include <memory>
 #include <sstream>
+#include <vector>
 
 using namespace yarpgen;
 
-ProgramGenerator::ProgramGenerator() : hash_seed(0) {
+ProgramGenerator::ProgramGenerator() : hash_seed(0), precompute_hash(false) {
     // Generate the general structure of the test
-    auto gen_ctx = std::make_shared<GenCtx>();
-    new_test = ScopeStmt::generateStructure(gen_ctx);
+    {
+        PhaseTimer timer(GenPhase::GEN_STRUCTURE);
+        auto gen_ctx = std::make_shared<GenCtx>();
+        new_test = ScopeStmt::generateStructure(gen_ctx);
+    }
+
+    PhaseTimer populate_timer(GenPhase::POPULATE);
 
     // Prepare to generate some math inside the structure
     ext_inp_sym_tbl = std::make_shared<SymbolTable>();
@@ -44,7 +49,7 @@ ProgramGenerator::ProgramGenerator() : hash_seed(0) {
         auto new_var = ScalarVar::create(pop_ctx);
         ext_inp_sym_tbl->addVar(new_var);
         ext_inp_sym_tbl->addVarExpr(
-            std::make_shared<ScalarVarUseExpr>(new_var));
+            makeIRNode<ScalarVarUseExpr>(new_var));
     }
 
     pop_ctx->setExtInpSymTable(ext_inp_sym_tbl);
@@ -54,15 +59,56 @@ ProgramGenerator::ProgramGenerator() : hash_seed(0) {
 
     // Create a special variable that we use to hide the information from
     // compiler
-    auto zero_var = std::make_shared<ScalarVar>(
+    auto zero_var = makeIRNode<ScalarVar>(
         "zero", IntegralType::init(IntTypeID::INT),
         IRValue(IntTypeID::INT, IRValue::AbsValue{false, 0}));
     zero_var->setIsDead(false);
     ext_inp_sym_tbl->addVar(zero_var);
 }
 
-void ProgramGenerator::emitCheckFunc(std::ostream &stream) {
-    std::ostream &out_file = stream;
+// Name of the lanes hash function for the arrays of the given type
+static std::string getHashLanesFuncName(IntTypeID type_id) {
+    return "hash_lanes_" + std::to_string(static_cast<int>(type_id));
+}
+
+// The lanes hash goes through the elements of the array in the memory order.
+// The element with index i is hashed into the lane i % hash_lanes_num, and the
+// lanes are hashed into the seed after that. The lanes are updated one after
+// another in the unrolled body, so the code is fast even without optimizations
+// and it is easy to vectorize.
+static void emitHashLanesFunc(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                              IntTypeID type_id) {
+    std::string type_name = IntegralType::init(type_id)->getName(ctx);
+    auto emit_lane_update = [&stream](size_t offset, const std::string &lane,
+                                      const std::string &elem) {
+        stream.indent(offset) << "lanes[" << lane << "] ^= "
+                              << "(unsigned long long int)arr[" << elem
+                              << "] + 0x9e3779b9 + (lanes[" << lane
+                              << "]<<6) + (lanes[" << lane << "]>>2);\n";
+    };
+
+    stream << "void " << getHashLanesFuncName(type_id)
+           << "(unsigned long long int *seed, void *ptr, "
+              "unsigned long long int size) {\n";
+    stream << "    " << type_name << " *arr = (" << type_name << " *)ptr;\n";
+    stream << "    unsigned long long int lanes[" << Options::hash_lanes_num
+           << "] = {0};\n";
+    stream << "    unsigned long long int i = 0;\n";
+    stream << "    for (; i + " << Options::hash_lanes_num << " <= size; i += "
+           << Options::hash_lanes_num << ") {\n";
+    for (size_t i = 0; i < Options::hash_lanes_num; ++i)
+        emit_lane_update(2, std::to_string(i), "i + " + std::to_string(i));
+    stream << "    }\n";
+    stream << "    for (; i < size; ++i)\n";
+    emit_lane_update(2, "i % " + std::to_string(Options::hash_lanes_num), "i");
+    stream << "    for (i = 0; i < " << Options::hash_lanes_num << "; ++i)\n";
+    stream << "        hash(seed, lanes[i]);\n";
+    stream << "}\n\n";
+}
+
+void ProgramGenerator::emitCheckFunc(std::shared_ptr<EmitCtx> ctx,
+                                     EmitStream &stream) {
+    EmitStream &out_file = stream;
     out_file << "#include <stdio.h>\n\n";
 
     Options &options = Options::getInstance();
@@ -79,9 +125,15 @@ void ProgramGenerator::emitCheckFunc(std::ostream &stream) {
                 "int const v) {\n";
     out_file << "    *seed ^= v + 0x9e3779b9 + ((*seed)<<6) + ((*seed)>>2);\n";
     out_file << "}\n\n";
+
+    if (options.useLanesHash())
+        for (auto type_id = IntTypeID::BOOL;
+             type_id < IntTypeID::MAX_INT_TYPE_ID;
+             type_id = static_cast<IntTypeID>(static_cast<int>(type_id) + 1))
+            emitHashLanesFunc(ctx, stream, type_id);
 }
 
-static void emitVarsDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+static void emitVarsDecl(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
                          std::vector<std::shared_ptr<ScalarVar>> vars) {
     Options &options = Options::getInstance();
     if (options.isSYCL())
@@ -89,15 +141,15 @@ static void emitVarsDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     for (auto &var : vars) {
         if (!options.getAllowDeadData() && var->getIsDead())
             continue;
-        auto init_val = std::make_shared<ConstantExpr>(var->getInitValue());
-        auto decl_stmt = std::make_shared<DeclStmt>(var, init_val);
+        auto init_val = makeIRNode<ConstantExpr>(var->getInitValue());
+        auto decl_stmt = makeIRNode<DeclStmt>(var, init_val);
         decl_stmt->emit(ctx, stream);
         stream << "\n";
     }
     ctx->setSYCLPrefix("");
 }
 
-static void emitArrayDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+static void emitArrayDecl(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
                           std::vector<std::shared_ptr<Array>> arrays) {
     Options &options = Options::getInstance();
     for (auto &array : arrays) {
@@ -119,7 +171,7 @@ static void emitArrayDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 }
 
 void ProgramGenerator::emitDecl(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream) {
+                                EmitStream &stream) {
     emitVarsDecl(ctx, stream, ext_inp_sym_tbl->getVars());
     emitVarsDecl(ctx, stream, ext_out_sym_tbl->getVars());
 
@@ -127,36 +179,37 @@ void ProgramGenerator::emitDecl(std::shared_ptr<EmitCtx> ctx,
     emitArrayDecl(ctx, stream, ext_out_sym_tbl->getArrays());
 }
 
-static void emitArrayInit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+static void emitArrayInit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
                           std::vector<std::shared_ptr<Array>> arrays) {
     Options &options = Options::getInstance();
     for (const auto &array : arrays) {
         if (!options.getAllowDeadData() && array->getIsDead())
             continue;
-        std::string offset = "    ";
+        size_t offset = 1;
         auto type = array->getType();
         assert(type->isArrayType() && "Array should have an Array type");
         auto array_type = std::static_pointer_cast<ArrayType>(type);
         size_t idx = 0;
         for (const auto &dimension : array_type->getDimensions()) {
-            stream << offset << "for (size_t i_" << idx << " = 0; i_" << idx
-                   << " < " << dimension << "; ++i_" << idx << ") \n";
-            offset += "    ";
+            stream.indent(offset) << "for (size_t i_" << idx << " = 0; i_"
+                                  << idx << " < " << dimension << "; ++i_"
+                                  << idx << ") \n";
+            offset++;
             idx++;
         }
-        stream << offset << array->getName(ctx) << " ";
+        stream.indent(offset) << array->getName(ctx) << " ";
         for (size_t i = 0; i < idx; ++i)
             stream << "[i_" << i << "] ";
         stream << "= ";
         auto emit_const_expr = [&array, &ctx, &stream](bool use_main_vals) {
             auto init_val = array->getInitValues(use_main_vals);
-            auto init_const = std::make_shared<ConstantExpr>(init_val);
+            auto init_const = makeIRNode<ConstantExpr>(init_val);
             init_const->emit(ctx, stream);
         };
         if (array->getMulValsAxisIdx() != -1) {
             stream << "(i_" << array->getMulValsAxisIdx() << " % "
-                   << Options::vals_number << " == " << Options::main_val_idx
-                   << ") ? ";
+                   << Options::getInstance().getValsNumber()
+                   << " == " << Options::main_val_idx << ") ? ";
         }
         emit_const_expr(true);
         if (array->getMulValsAxisIdx() != -1) {
@@ -167,8 +220,188 @@ static void emitArrayInit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     }
 }
 
+// Compact driver describes each array with a row of a table, and the arrays
+// are initialized and checked by a generic code that walks through the table.
+// The code of the driver is the same for all tests, so its compile time doesn't
+// depend on the number and the shape of the arrays.
+static std::vector<std::shared_ptr<Array>>
+getLiveArrays(const std::vector<std::shared_ptr<Array>> &arrays) {
+    Options &options = Options::getInstance();
+    std::vector<std::shared_ptr<Array>> ret;
+    for (const auto &array : arrays)
+        if (options.getAllowDeadData() || !array->getIsDead())
+            ret.push_back(array);
+    return ret;
+}
+
+// Values are passed through the table converted to unsigned long long (the
+// same conversion happens in the hash)
+static std::string getCompactDriverValue(IRValue val) {
+    return std::to_string(val.getAbsValue().value) + "ULL";
+}
+
+static void emitCompactDriverRuntime(std::shared_ptr<EmitCtx> ctx,
+                                     EmitStream &stream) {
+    Options &options = Options::getInstance();
+    stream << "struct yarpgen_array {\n";
+    stream << "    void *ptr;\n";
+    stream << "    int kind;\n";
+    stream << "    unsigned long long int size;\n";
+    // Product of the dimensions after the axis of multiple values (or zero)
+    stream << "    unsigned long long int axis_inner;\n";
+    stream << "    unsigned long long int axis_dim;\n";
+    stream << "    unsigned long long int init_vals[2];\n";
+    stream << "    unsigned long long int res_vals[2];\n";
+    stream << "};\n\n";
+
+    // Kind of the element is its IntTypeID
+    auto emit_kind_switch = [&ctx, &stream](const std::string &action) {
+        stream << "    switch (kind) {\n";
+        for (auto type_id = IntTypeID::BOOL;
+             type_id < IntTypeID::MAX_INT_TYPE_ID;
+             type_id = static_cast<IntTypeID>(static_cast<int>(type_id) + 1)) {
+            std::string type_name = IntegralType::init(type_id)->getName(ctx);
+            stream << "        case " << static_cast<int>(type_id) << ": ";
+            stream << action << "((" << type_name << " *)ptr)[idx]";
+            if (action.empty())
+                stream << " = (" << type_name << ")val";
+            stream << "; break;\n";
+        }
+        stream << "    }\n";
+    };
+
+    stream << "static void yarpgen_store(void *ptr, int kind, "
+              "unsigned long long int idx, unsigned long long int val) {\n";
+    emit_kind_switch("");
+    stream << "}\n\n";
+
+    stream << "static unsigned long long int yarpgen_load(void *ptr, int kind, "
+              "unsigned long long int idx) {\n";
+    emit_kind_switch("return ");
+    stream << "    return 0;\n";
+    stream << "}\n\n";
+
+    stream << "static int yarpgen_val_idx(struct yarpgen_array *arr, "
+              "unsigned long long int idx) {\n";
+    stream << "    return arr->axis_inner != 0 && (idx / arr->axis_inner) % "
+              "arr->axis_dim % "
+           << Options::getInstance().getValsNumber()
+           << " != " << Options::main_val_idx
+           << ";\n";
+    stream << "}\n\n";
+
+    stream << "static void yarpgen_init_arrays(struct yarpgen_array *arrs, "
+              "unsigned long long int num) {\n";
+    stream << "    for (unsigned long long int i = 0; i < num; ++i)\n";
+    stream << "        for (unsigned long long int j = 0; j < arrs[i].size; "
+              "++j)\n";
+    stream << "            yarpgen_store(arrs[i].ptr, arrs[i].kind, j, "
+              "arrs[i].init_vals[yarpgen_val_idx(&arrs[i], j)]);\n";
+    stream << "}\n\n";
+
+    if (options.getCheckAlgo() == CheckAlgo::ASSERTS) {
+        // Each element has to match one of the values of the array
+        stream << "static int yarpgen_check_arrays(struct yarpgen_array *arrs, "
+                  "unsigned long long int num) {\n";
+        stream << "    int mismatch = 0;\n";
+        stream << "    for (unsigned long long int i = 0; i < num; ++i)\n";
+        stream << "        for (unsigned long long int j = 0; j < "
+                  "arrs[i].size; ++j) {\n";
+        stream << "            unsigned long long int val = "
+                  "yarpgen_load(arrs[i].ptr, arrs[i].kind, j);\n";
+        stream << "            int match = val == arrs[i].res_vals[0] || "
+                  "val == arrs[i].init_vals[0];\n";
+        stream << "            if (arrs[i].axis_inner != 0)\n";
+        stream << "                match = match || val == arrs[i].res_vals[1] "
+                  "|| val == arrs[i].init_vals[1];\n";
+        stream << "            mismatch |= !match;\n";
+        stream << "        }\n";
+        stream << "    return mismatch;\n";
+        stream << "}\n\n";
+    }
+    else {
+        stream << "static void yarpgen_hash_arrays(struct yarpgen_array *arrs, "
+                  "unsigned long long int num) {\n";
+        stream << "    for (unsigned long long int i = 0; i < num; ++i)\n";
+        if (options.useLanesHash()) {
+            stream << "        switch (arrs[i].kind) {\n";
+            for (auto type_id = IntTypeID::BOOL;
+                 type_id < IntTypeID::MAX_INT_TYPE_ID;
+                 type_id =
+                     static_cast<IntTypeID>(static_cast<int>(type_id) + 1))
+                stream << "            case " << static_cast<int>(type_id)
+                       << ": " << getHashLanesFuncName(type_id)
+                       << "(&seed, arrs[i].ptr, arrs[i].size); break;\n";
+            stream << "        }\n";
+        }
+        else {
+            stream << "        for (unsigned long long int j = 0; j < "
+                      "arrs[i].size; ++j)\n";
+            stream << "            hash(&seed, yarpgen_load(arrs[i].ptr, "
+                      "arrs[i].kind, j));\n";
+        }
+        stream << "}\n\n";
+    }
+}
+
+static void emitCompactArrayTable(std::shared_ptr<EmitCtx> ctx,
+                                  EmitStream &stream,
+                                  std::vector<std::shared_ptr<Array>> arrays) {
+    stream << "struct yarpgen_array yarpgen_arrays[] = {\n";
+    for (const auto &array : arrays) {
+        auto type = array->getType();
+        assert(type->isArrayType() && "Array should have an Array type");
+        auto array_type = std::static_pointer_cast<ArrayType>(type);
+        auto base_type = array_type->getBaseType();
+        assert(base_type->isIntType() && "We support only int type for now");
+        auto &dims = array_type->getDimensions();
+
+        size_t size = 1;
+        for (const auto &dimension : dims)
+            size *= dimension;
+        size_t axis_inner = 0;
+        size_t axis_dim = 0;
+        int64_t axis_idx = array->getMulValsAxisIdx();
+        if (axis_idx != -1) {
+            axis_dim = dims.at(axis_idx);
+            axis_inner = 1;
+            for (size_t i = axis_idx + 1; i < dims.size(); ++i)
+                axis_inner *= dims.at(i);
+        }
+
+        stream << "    {(void *)" << array->getName(ctx) << ", "
+               << static_cast<int>(
+                      std::static_pointer_cast<IntegralType>(base_type)
+                          ->getIntTypeId())
+               << ", " << size << ", " << axis_inner << ", " << axis_dim
+               << ", {" << getCompactDriverValue(array->getInitValues(true))
+               << ", " << getCompactDriverValue(array->getInitValues(false))
+               << "}, {"
+               << getCompactDriverValue(array->getCurrentValues(true)) << ", "
+               << getCompactDriverValue(array->getCurrentValues(false))
+               << "}},\n";
+    }
+    stream << "};\n\n";
+}
+
 void ProgramGenerator::emitInit(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream) {
+                                EmitStream &stream) {
+    Options &options = Options::getInstance();
+    if (options.getCompactDriver()) {
+        auto arrays = getLiveArrays(ext_inp_sym_tbl->getArrays());
+        auto out_arrays = getLiveArrays(ext_out_sym_tbl->getArrays());
+        arrays.insert(arrays.end(), out_arrays.begin(), out_arrays.end());
+        emitCompactDriverRuntime(ctx, stream);
+        if (!arrays.empty())
+            emitCompactArrayTable(ctx, stream, arrays);
+        stream << "void init() {\n";
+        if (!arrays.empty())
+            stream << "    yarpgen_init_arrays(yarpgen_arrays, "
+                   << arrays.size() << ");\n";
+        stream << "}\n\n";
+        return;
+    }
+
     stream << "void init() {\n";
     emitArrayInit(ctx, stream, ext_inp_sym_tbl->getArrays());
     emitArrayInit(ctx, stream, ext_out_sym_tbl->getArrays());
@@ -176,7 +409,7 @@ void ProgramGenerator::emitInit(std::shared_ptr<EmitCtx> ctx,
 }
 
 void ProgramGenerator::emitCheck(std::shared_ptr<EmitCtx> ctx,
-                                 std::ostream &stream) {
+                                 EmitStream &stream) {
     stream << "void checksum() {\n";
 
     Options &options = Options::getInstance();
@@ -189,15 +422,14 @@ void ProgramGenerator::emitCheck(std::shared_ptr<EmitCtx> ctx,
     for (auto &var : ext_out_sym_tbl->getVars()) {
         std::string var_name = var->getName(ctx);
 
-        if (options.getCheckAlgo() == CheckAlgo::HASH ||
-            options.getCheckAlgo() == CheckAlgo::PRECOMPUTE) {
+        if (options.useHashCheck()) {
             stream << "    hash(&seed, " << var_name << ");\n";
-            if (options.getCheckAlgo() == CheckAlgo::PRECOMPUTE)
+            if (precompute_hash)
                 hash(var->getCurrentValue().getAbsValue().value);
         }
         else if (options.getCheckAlgo() == CheckAlgo::ASSERTS) {
             auto const_val =
-                std::make_shared<ConstantExpr>(var->getCurrentValue());
+                makeIRNode<ConstantExpr>(var->getCurrentValue());
             stream << "    value_mismatch |= " << var_name << " != ";
             const_val->emit(ctx, stream);
             stream << ";\n";
@@ -209,44 +441,80 @@ void ProgramGenerator::emitCheck(std::shared_ptr<EmitCtx> ctx,
 
     ctx->setSYCLPrefix("");
 
+    if (options.getCompactDriver()) {
+        // Output arrays are at the end of the table
+        size_t inp_arrays_num =
+            getLiveArrays(ext_inp_sym_tbl->getArrays()).size();
+        auto out_arrays = getLiveArrays(ext_out_sym_tbl->getArrays());
+        if (!out_arrays.empty()) {
+            if (options.getCheckAlgo() == CheckAlgo::ASSERTS)
+                stream << "    value_mismatch |= yarpgen_check_arrays(";
+            else
+                stream << "    yarpgen_hash_arrays(";
+            stream << "yarpgen_arrays + " << inp_arrays_num << ", "
+                   << out_arrays.size() << ");\n";
+        }
+        if (precompute_hash)
+            for (const auto &array : out_arrays)
+                hashArray(array);
+        stream << "}\n";
+        return;
+    }
+
     for (const auto &array : ext_out_sym_tbl->getArrays()) {
-        std::string offset = "    ";
+        size_t offset = 1;
         auto type = array->getType();
         assert(type->isArrayType() && "Array should have an Array type");
         auto array_type = std::static_pointer_cast<ArrayType>(type);
+
+        if (options.useLanesHash()) {
+            // Arrays are contiguous, so they are hashed as a whole
+            auto base_type = array_type->getBaseType();
+            assert(base_type->isIntType() && "We support only int type");
+            auto type_id = std::static_pointer_cast<IntegralType>(base_type)
+                               ->getIntTypeId();
+            size_t size = 1;
+            for (const auto &dimension : array_type->getDimensions())
+                size *= dimension;
+            stream << "    " << getHashLanesFuncName(type_id) << "(&seed, "
+                   << "(void *)" << array->getName(ctx) << ", " << size
+                   << ");\n";
+            if (precompute_hash)
+                hashArray(array);
+            continue;
+        }
+
         size_t idx = 0;
-        std::stringstream ss;
-        ss << array->getName(ctx) << " ";
+        std::string arr_name = array->getName(ctx) + " ";
         for (const auto &dimension : array_type->getDimensions()) {
-            stream << offset << "for (size_t i_" << idx << " = 0; i_" << idx
-                   << " < " << dimension << "; ++i_" << idx << ") \n";
-            ss << "[i_" << idx << "] ";
-            offset += "    ";
+            stream.indent(offset) << "for (size_t i_" << idx << " = 0; i_"
+                                  << idx << " < " << dimension << "; ++i_"
+                                  << idx << ") \n";
+            arr_name += "[i_" + std::to_string(idx) + "] ";
+            offset++;
             idx++;
         }
 
-        if (options.getCheckAlgo() == CheckAlgo::HASH ||
-            options.getCheckAlgo() == CheckAlgo::PRECOMPUTE) {
-            stream << offset << "hash(&seed, ";
-            if (options.getCheckAlgo() == CheckAlgo::PRECOMPUTE)
+        if (options.useHashCheck()) {
+            stream.indent(offset) << "hash(&seed, ";
+            if (precompute_hash)
                 hashArray(array);
         }
         else if (options.getCheckAlgo() == CheckAlgo::ASSERTS)
-            stream << offset << "value_mismatch |= ";
+            stream.indent(offset) << "value_mismatch |= ";
         else
             ERROR("Unsupported");
 
-        std::string arr_name = ss.str();
         stream << arr_name;
 
         if (options.getCheckAlgo() == CheckAlgo::ASSERTS) {
             auto const_val =
-                std::make_shared<ConstantExpr>((array->getCurrentValues(true)));
+                makeIRNode<ConstantExpr>((array->getCurrentValues(true)));
             stream << "!= ";
             const_val->emit(ctx, stream);
             auto emit_cmp = [&arr_name, &ctx, &stream](IRValue val) {
                 stream << " && " << arr_name << "!= ";
-                auto const_val = std::make_shared<ConstantExpr>(val);
+                auto const_val = makeIRNode<ConstantExpr>(val);
                 const_val->emit(ctx, stream);
             };
             emit_cmp(array->getInitValues(true));
@@ -262,14 +530,10 @@ void ProgramGenerator::emitCheck(std::shared_ptr<EmitCtx> ctx,
     stream << "}\n";
 }
 
-// This buffer tracks what input data we pass as a parameters to test functions
-static std::vector<std::string> pass_as_param_buffer;
-static bool any_vars_as_params = false;
-static bool any_arrays_as_params = false;
-
-static void emitVarExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+static void emitVarExtDecl(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
                            std::vector<std::shared_ptr<ScalarVar>> vars,
-                           bool inp_category) {
+                           bool inp_category,
+                           std::vector<std::string> &pass_as_param_buffer) {
     auto emit_pol = ctx->getEmitPolicy();
     Options &options = Options::getInstance();
     if (options.isSYCL())
@@ -288,7 +552,6 @@ static void emitVarExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 
         if (pass_as_param) {
             pass_as_param_buffer.push_back(var->getName(ctx));
-            any_vars_as_params = true;
             continue;
         }
         stream << "extern ";
@@ -299,9 +562,10 @@ static void emitVarExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     ctx->setSYCLPrefix("");
 }
 
-static void emitArrayExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+static void emitArrayExtDecl(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
                              std::vector<std::shared_ptr<Array>> arrays,
-                             bool inp_category) {
+                             bool inp_category,
+                             std::vector<std::string> &pass_as_param_buffer) {
     auto emit_pol = ctx->getEmitPolicy();
     Options &options = Options::getInstance();
     for (auto &array : arrays) {
@@ -318,7 +582,6 @@ static void emitArrayExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 
         if (pass_as_param) {
             pass_as_param_buffer.push_back(array->getName(ctx));
-            any_arrays_as_params = true;
             continue;
         }
 
@@ -368,22 +631,27 @@ static void emitArrayExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 }
 
 void ProgramGenerator::emitExtDecl(std::shared_ptr<EmitCtx> ctx,
-                                   std::ostream &stream) {
+                                   EmitStream &stream) {
     Options &options = Options::getInstance();
     if (options.isISPC())
         ctx->setIspcTypes(true);
-    emitVarExtDecl(ctx, stream, ext_inp_sym_tbl->getVars(), true);
-    emitVarExtDecl(ctx, stream, ext_out_sym_tbl->getVars(), false);
-    emitArrayExtDecl(ctx, stream, ext_inp_sym_tbl->getArrays(), true);
-    emitArrayExtDecl(ctx, stream, ext_out_sym_tbl->getArrays(), false);
+    emitVarExtDecl(ctx, stream, ext_inp_sym_tbl->getVars(), true,
+                   pass_as_param_buffer);
+    emitVarExtDecl(ctx, stream, ext_out_sym_tbl->getVars(), false,
+                   pass_as_param_buffer);
+    emitArrayExtDecl(ctx, stream, ext_inp_sym_tbl->getArrays(), true,
+                     pass_as_param_buffer);
+    emitArrayExtDecl(ctx, stream, ext_out_sym_tbl->getArrays(), false,
+                     pass_as_param_buffer);
     ctx->setIspcTypes(false);
 }
 
 static std::string placeSep(bool cond) { return cond ? ", " : ""; }
 
-static bool emitVarFuncParam(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+static bool emitVarFuncParam(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
                              std::vector<std::shared_ptr<ScalarVar>> vars,
-                             bool emit_type, bool ispc_type) {
+                             bool emit_type, bool ispc_type,
+                             std::vector<std::string> &pass_as_param_buffer) {
     bool emit_any = false;
     Options &options = Options::getInstance();
     if (options.isSYCL())
@@ -406,9 +674,10 @@ static bool emitVarFuncParam(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 }
 
 static void emitArrayFuncParam(std::shared_ptr<EmitCtx> ctx,
-                               std::ostream &stream, bool prev_category_exist,
+                               EmitStream &stream, bool prev_category_exist,
                                std::vector<std::shared_ptr<Array>> arrays,
-                               bool emit_type, bool ispc_type, bool emit_dims) {
+                               bool emit_type, bool ispc_type, bool emit_dims,
+                               std::vector<std::string> &pass_as_param_buffer) {
     bool first = true;
     Options &options = Options::getInstance();
     for (auto &array : arrays) {
@@ -433,36 +702,36 @@ static void emitArrayFuncParam(std::shared_ptr<EmitCtx> ctx,
     }
 }
 
-void emitSYCLBuffers(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                     std::string offset,
+void emitSYCLBuffers(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                     size_t offset,
                      std::vector<std::shared_ptr<ScalarVar>> vars) {
     Options &options = Options::getInstance();
     for (auto &var : vars) {
         if (!options.getAllowDeadData() && var->getIsDead())
             continue;
-        stream << offset << "buffer<";
+        stream.indent(offset) << "buffer<";
         stream << var->getType()->getName(ctx);
         stream << ", 1> " << var->getName(ctx) << "_buf { ";
         stream << "&app_" << var->getName(ctx) << ", range<1>(1) };\n";
     }
 }
 
-void emitSYCLAccessors(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                       std::string offset,
+void emitSYCLAccessors(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                       size_t offset,
                        std::vector<std::shared_ptr<ScalarVar>> vars,
                        bool is_inp) {
     Options &options = Options::getInstance();
     for (auto &var : vars) {
         if (!options.getAllowDeadData() && var->getIsDead())
             continue;
-        stream << offset << "auto " << var->getName(ctx) << " = ";
+        stream.indent(offset) << "auto " << var->getName(ctx) << " = ";
         stream << var->getName(ctx) << "_buf.get_access<access::mode::";
         stream << (is_inp ? "read" : "write") << ">(cgh);\n";
     }
 }
 
 void ProgramGenerator::emitTest(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream) {
+                                EmitStream &stream) {
     Options &options = Options::getInstance();
     stream << "#include \"init.h\"\n";
     if (options.isC()) {
@@ -485,10 +754,11 @@ void ProgramGenerator::emitTest(std::shared_ptr<EmitCtx> ctx,
     stream << "void test(";
 
     bool emit_any = emitVarFuncParam(ctx, stream, ext_inp_sym_tbl->getVars(),
-                                     true, options.isISPC());
+                                     true, options.isISPC(),
+                                     pass_as_param_buffer);
 
     emitArrayFuncParam(ctx, stream, emit_any, ext_inp_sym_tbl->getArrays(),
-                       true, options.isISPC(), true);
+                       true, options.isISPC(), true, pass_as_param_buffer);
 
     stream << ") ";
 
@@ -509,20 +779,18 @@ void ProgramGenerator::emitTest(std::shared_ptr<EmitCtx> ctx,
         stream << "        default_selector selector;\n";
         stream << "#endif\n";
         stream << "        queue myQueue(selector);\n";
-        emitSYCLBuffers(ctx, stream, "        ", ext_inp_sym_tbl->getVars());
-        emitSYCLBuffers(ctx, stream, "        ", ext_out_sym_tbl->getVars());
+        emitSYCLBuffers(ctx, stream, 2, ext_inp_sym_tbl->getVars());
+        emitSYCLBuffers(ctx, stream, 2, ext_out_sym_tbl->getVars());
 
         stream << "        myQueue.submit([&](handler & cgh) {\n";
-        emitSYCLAccessors(ctx, stream, "            ",
-                          ext_inp_sym_tbl->getVars(), true);
-        emitSYCLAccessors(ctx, stream, "            ",
-                          ext_out_sym_tbl->getVars(), false);
+        emitSYCLAccessors(ctx, stream, 3, ext_inp_sym_tbl->getVars(), true);
+        emitSYCLAccessors(ctx, stream, 3, ext_out_sym_tbl->getVars(), false);
         stream << "            cgh.single_task<class test_func>([=] ()\n";
     }
 
     if (options.isSYCL())
         ctx->setSYCLAccess(true);
-    new_test->emit(ctx, stream, !options.isSYCL() ? "" : "            ");
+    new_test->emit(ctx, stream, !options.isSYCL() ? 0 : 3);
 
     if (options.isSYCL()) {
         stream << "            );\n";
@@ -535,7 +803,7 @@ void ProgramGenerator::emitTest(std::shared_ptr<EmitCtx> ctx,
 }
 
 void ProgramGenerator::emitMain(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream) {
+                                EmitStream &stream) {
     Options &options = Options::getInstance();
     if (options.isISPC())
         stream << "extern \"C\" { ";
@@ -543,9 +811,10 @@ void ProgramGenerator::emitMain(std::shared_ptr<EmitCtx> ctx,
     stream << "void test(";
 
     bool emit_any =
-        emitVarFuncParam(ctx, stream, ext_inp_sym_tbl->getVars(), true, false);
+        emitVarFuncParam(ctx, stream, ext_inp_sym_tbl->getVars(), true, false,
+                         pass_as_param_buffer);
     emitArrayFuncParam(ctx, stream, emit_any, ext_inp_sym_tbl->getArrays(),
-                       true, false, true);
+                       true, false, true, pass_as_param_buffer);
 
     stream << ");";
     if (options.isISPC())
@@ -556,15 +825,16 @@ void ProgramGenerator::emitMain(std::shared_ptr<EmitCtx> ctx,
     stream << "    test(";
 
     emit_any =
-        emitVarFuncParam(ctx, stream, ext_inp_sym_tbl->getVars(), false, false);
+        emitVarFuncParam(ctx, stream, ext_inp_sym_tbl->getVars(), false, false,
+                         pass_as_param_buffer);
 
     emitArrayFuncParam(ctx, stream, emit_any, ext_inp_sym_tbl->getArrays(),
-                       false, false, false);
+                       false, false, false, pass_as_param_buffer);
 
     stream << ");\n";
     stream << "    checksum();\n";
     stream << "    printf(\"%llu\\n\", seed);\n";
-    if (options.getCheckAlgo() == CheckAlgo::PRECOMPUTE) {
+    if (precompute_hash) {
         stream << "    if (seed != " << hash_seed << "ULL) \n";
         stream << "        printf(\"ERROR: hash mismatch\\n\");\n";
     }
@@ -575,7 +845,26 @@ void ProgramGenerator::emitMain(std::shared_ptr<EmitCtx> ctx,
     stream << "}\n";
 }
 
+// Pre-computation of the hash goes through every element of the output arrays,
+// and it takes more time than the generation of the test for the big ones.
+// In this case the driver just reports the hash, as with the runtime check.
+static const size_t PRECOMPUTE_MAX_ELEMS_NUM = 1ULL << 28;
+
+static size_t
+getArraysElemsNum(const std::vector<std::shared_ptr<Array>> &arrays) {
+    size_t ret = 0;
+    for (const auto &array : arrays) {
+        auto array_type = std::static_pointer_cast<ArrayType>(array->getType());
+        size_t size = 1;
+        for (const auto &dimension : array_type->getDimensions())
+            size *= dimension;
+        ret += size;
+    }
+    return ret;
+}
+
 void ProgramGenerator::emit() {
+    PhaseTimer timer(GenPhase::EMIT);
     Options &options = Options::getInstance();
     auto emit_ctx = std::make_shared<EmitCtx>();
     // We need to narrow options if we were asked to do so
@@ -586,20 +875,14 @@ void ProgramGenerator::emit() {
         options.setAlignSize(align_size);
     }
 
-    std::ofstream out_file;
+    // The same buffer is used for all of the files
+    EmitStream out_file;
 
     // TODO: probably won't work on Windows
     std::string out_dir = options.getOutDir() + "/";
 
-    auto open_file = [&out_file, &out_dir](std::string file_name) {
-        out_file.open(out_dir + file_name);
-        if (!out_file)
-            ERROR(std::string("Can't open file ") + file_name);
-    };
-
-    open_file("init.h");
     emitExtDecl(emit_ctx, out_file);
-    out_file.close();
+    out_file.writeToFile(out_dir + "init.h");
 
     std::string func_file_ext, driver_file_ext;
     if (options.isC()) {
@@ -614,65 +897,279 @@ void ProgramGenerator::emit() {
         func_file_ext = "ispc";
         driver_file_ext = "cpp";
     }
-    open_file("func." + func_file_ext);
-    out_file << "/*\n";
-    options.dump(out_file);
-    out_file << "*/\n";
+    precompute_hash = options.usePrecomputedHash() &&
+                      getArraysElemsNum(ext_out_sym_tbl->getArrays()) <=
+                          PRECOMPUTE_MAX_ELEMS_NUM;
+
+    std::ostringstream options_dump;
+    options.dump(options_dump);
+    if (Statistics::getInstance().getBudgetLimitNum() != 0)
+        options_dump << "Generation budget was reached, the rest of the test "
+                        "was generated with a reduced policy\n";
+    // The time budget depends on the machine, so we record the option that
+    // reproduces the test without it
+    size_t budget_trip_point = GenSession::getCurrent().getBudgetTripPoint();
+    if (budget_trip_point != 0)
+        options_dump << "Time budget was reached, add --budget-trip-point="
+                     << budget_trip_point
+                     << " to the invocation to reproduce the test\n";
+    if (options.usePrecomputedHash() && !precompute_hash)
+        options_dump << "Output arrays are too big, so the hash is not "
+                        "pre-computed\n";
+    out_file << "/*\n" << options_dump.str() << "*/\n";
     emitTest(emit_ctx, out_file);
-    out_file.close();
+    out_file.writeToFile(out_dir + "func." + func_file_ext);
+
+    if (precompute_hash)
+        collectOutArrayStores();
 
-    open_file("driver." + driver_file_ext);
-    emitCheckFunc(out_file);
+    emitCheckFunc(emit_ctx, out_file);
     emitDecl(emit_ctx, out_file);
     emitInit(emit_ctx, out_file);
     emitCheck(emit_ctx, out_file);
     emitMain(emit_ctx, out_file);
-    out_file.close();
+    out_file.writeToFile(out_dir + "driver." + driver_file_ext);
+}
+
+// This function has to be exactly the same as the one that we use for hash
+// computation
+static void hashCombine(unsigned long long int &seed,
+                        unsigned long long int const v) {
+    seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 }
 
 void ProgramGenerator::hash(unsigned long long int const v) {
-    // This function has to be exactly the same as the one that we use for hash
-    // computation
-    hash_seed ^= v + 0x9e3779b9 + (hash_seed << 6) + (hash_seed >> 2);
+    hashCombine(hash_seed, v);
+}
+
+// Model of the final values of an output array. Each output array is written
+// by a single store, so its element has the current value if the store reached
+// it, and the initial value otherwise (main or alternative one, depending on
+// the index along the axis of multiple values).
+// The store is executed on every iteration of the enclosing loops, and each
+// dimension is indexed with a constant or with a function of one iterator.
+// Dimensions that are indexed with the iterator of the same loop form a group,
+// and the set of the written elements is a product of the sets of the groups.
+// Each set is a bitmap over the dimensions of its group, so we never need to
+// store anything per element of the array.
+namespace {
+// Index of the dimension as a function of the iterator value
+struct SubsIdxFunc {
+    std::shared_ptr<Data> iter = nullptr;
+    int64_t const_val = 0;
+    std::vector<int64_t> mods;
+    int64_t offset = 0;
+
+    int64_t apply(int64_t val) const {
+        for (auto mod : mods)
+            val %= mod;
+        return val + offset;
+    }
+};
+
+struct WrittenGroup {
+    std::vector<size_t> dims_idx;
+    std::vector<uint8_t> bitmap;
+
+    size_t getLinearIdx(const std::vector<size_t> &dims,
+                        const std::vector<size_t> &idx) const {
+        size_t ret = 0;
+        for (auto dim_idx : dims_idx)
+            ret = ret * dims[dim_idx] + idx[dim_idx];
+        return ret;
+    }
+};
+} // namespace
+
+static int64_t getIntValue(std::shared_ptr<Data> data) {
+    if (!data->isScalarVar())
+        ERROR("Scalar variable is expected");
+    IRValue val = std::static_pointer_cast<ScalarVar>(data)
+                      ->getCurrentValue()
+                      .castToType(IntTypeID::LLONG);
+    return val.getValueRef<int64_t>();
+}
+
+static int64_t evalIntValue(std::shared_ptr<Expr> expr) {
+    EvalCtx eval_ctx;
+    return getIntValue(expr->evaluate(eval_ctx));
+}
+
+static void parseSubsIdx(std::shared_ptr<Expr> expr, SubsIdxFunc &func) {
+    if (expr->getKind() == IRNodeKind::CONST)
+        func.const_val = getIntValue(expr->getValue());
+    else if (expr->getKind() == IRNodeKind::ITER_USE)
+        func.iter = expr->getValue();
+    else if (expr->getKind() == IRNodeKind::TYPE_CAST)
+        // Indices are small non-negative numbers, so casts don't change them
+        parseSubsIdx(std::static_pointer_cast<TypeCastExpr>(expr)->getExpr(),
+                     func);
+    else if (expr->getKind() == IRNodeKind::BINARY &&
+             std::static_pointer_cast<BinaryExpr>(expr)->getOp() ==
+                 BinaryOp::MOD) {
+        // SubscriptExpr::rebuild wraps the index to fit the dimension
+        auto bin_expr = std::static_pointer_cast<BinaryExpr>(expr);
+        parseSubsIdx(bin_expr->getLHS(), func);
+        func.mods.push_back(evalIntValue(bin_expr->getRHS()));
+    }
+    else
+        ERROR("Unsupported index of the output array");
+}
+
+void ProgramGenerator::collectOutArrayStores() {
+    std::vector<std::shared_ptr<LoopHead>> loops;
+    std::vector<ArrayStore> stores;
+    new_test->collectArrayStores(loops, stores);
+    for (auto &store : stores) {
+        std::shared_ptr<Expr> expr = store.subs;
+        while (expr->getKind() == IRNodeKind::SUBSCRIPT) {
+            auto subs = std::static_pointer_cast<SubscriptExpr>(expr);
+            expr = subs->getArrayExpr();
+        }
+        if (expr->getKind() != IRNodeKind::ARRAY_USE)
+            ERROR("Bad IRNodeKind");
+        auto insert_res = out_array_stores.emplace(expr->getValue(), store);
+        if (!insert_res.second)
+            ERROR("Output array should be written by a single store");
+    }
+}
+
+static std::vector<WrittenGroup>
+getWrittenGroups(const std::vector<size_t> &dims, ArrayStore &store) {
+    // Subscripts are nested, so the outermost one is for the last dimension
+    std::vector<SubsIdxFunc> idx_funcs(dims.size());
+    std::shared_ptr<Expr> expr = store.subs;
+    for (size_t i = dims.size(); i-- > 0;) {
+        auto subs = std::static_pointer_cast<SubscriptExpr>(expr);
+        parseSubsIdx(subs->getIdxExpr(), idx_funcs.at(i));
+        idx_funcs.at(i).offset = subs->getOffset();
+        expr = subs->getArrayExpr();
+    }
+
+    std::vector<WrittenGroup> groups;
+    auto add_group = [&dims, &groups](std::vector<size_t> dims_idx) {
+        size_t size = 1;
+        for (auto dim_idx : dims_idx)
+            size *= dims.at(dim_idx);
+        groups.push_back({std::move(dims_idx), std::vector<uint8_t>(size)});
+        return &groups.back();
+    };
+
+    std::vector<size_t> idx(dims.size());
+    auto set_bit = [&dims, &idx_funcs, &idx](WrittenGroup *group,
+                                             int64_t iter_val) {
+        for (auto dim_idx : group->dims_idx) {
+            int64_t val = idx_funcs.at(dim_idx).apply(iter_val);
+            if (val < 0 || static_cast<uint64_t>(val) >= dims.at(dim_idx))
+                ERROR("Store to the output array is out of bounds");
+            idx.at(dim_idx) = static_cast<size_t>(val);
+        }
+        group->bitmap.at(group->getLinearIdx(dims, idx)) = true;
+    };
+
+    for (size_t i = 0; i < dims.size(); ++i)
+        if (!idx_funcs.at(i).iter)
+            set_bit(add_group({i}), idx_funcs.at(i).const_val);
+
+    std::vector<bool> grouped(dims.size(), false);
+    for (auto &loop : store.loops) {
+        auto iter = loop->getIterators().front();
+        int64_t start = evalIntValue(iter->getStart());
+        int64_t end = evalIntValue(iter->getEnd());
+        int64_t step = evalIntValue(iter->getStep());
+        // Nothing is written if any of the loops doesn't have iterations
+        if (start >= end)
+            return {};
+
+        std::vector<size_t> dims_idx;
+        for (size_t i = 0; i < dims.size(); ++i)
+            if (idx_funcs.at(i).iter == iter) {
+                dims_idx.push_back(i);
+                grouped.at(i) = true;
+            }
+        if (dims_idx.empty())
+            continue;
+        auto group = add_group(std::move(dims_idx));
+        for (int64_t val = start; val < end; val += step)
+            set_bit(group, val);
+    }
+
+    for (size_t i = 0; i < dims.size(); ++i)
+        if (idx_funcs.at(i).iter && !grouped.at(i))
+            ERROR("Output array is indexed with an unknown iterator");
+    return groups;
 }
 
 void ProgramGenerator::hashArray(std::shared_ptr<Array> const &arr) {
     assert(arr->getType()->isArrayType() && "Array should have array type");
     auto arr_type = std::static_pointer_cast<ArrayType>(arr->getType());
-    std::vector<size_t> idx_vec(arr_type->getDimensions().size(), 0);
     auto &dims = arr_type->getDimensions();
-    // TODO: this is broken now
-    uint64_t init_val =
-        arr->getInitValues(Options::main_val_idx).getAbsValue().value;
-    uint64_t cur_val =
-        arr->getCurrentValues(Options::main_val_idx).getAbsValue().value;
-    std::vector<size_t> steps = {};
-    hashArrayStep(arr, dims, idx_vec, 0, false, init_val, cur_val, steps);
-}
-
-void ProgramGenerator::hashArrayStep(std::shared_ptr<Array> const &arr,
-                                     std::vector<size_t> &dims,
-                                     std::vector<size_t> &idx_vec,
-                                     size_t cur_idx, bool has_to_use_init_val,
-                                     uint64_t &init_val, uint64_t &cur_val,
-                                     std::vector<size_t> &steps) {
-    size_t vec_last_idx = idx_vec.size() - 1;
-    // TODO: this is also broken
-    size_t cur_val_size = 0;
-    size_t cur_dim = dims[cur_idx];
-    size_t cur_step = steps[cur_idx];
-
-    for (size_t i = 0; i < cur_dim; ++i) {
-        has_to_use_init_val |= (i >= cur_val_size);
-        if (cur_idx != vec_last_idx) {
-            idx_vec[cur_idx] = i;
-            hashArrayStep(arr, dims, idx_vec, cur_idx + 1,
-                          has_to_use_init_val || (i % cur_step != 0), init_val,
-                          cur_val, steps);
+
+    bool written = false;
+    std::vector<WrittenGroup> groups;
+    auto find_res = out_array_stores.find(arr);
+    if (find_res != out_array_stores.end()) {
+        groups = getWrittenGroups(dims, find_res->second);
+        written = !groups.empty();
+    }
+
+    // Values that are hashed, indexed with [written][use_main_vals]
+    uint64_t vals[2][2];
+    for (bool use_main_vals : {false, true}) {
+        vals[0][use_main_vals] =
+            arr->getInitValues(use_main_vals).getAbsValue().value;
+        vals[1][use_main_vals] =
+            arr->getCurrentValues(use_main_vals).getAbsValue().value;
+    }
+
+    // The elements are hashed in the same order as in the driver. We go over
+    // the rows along the last dimension, so the inner loop only has to check
+    // one slice of the bitmap of the group with the last dimension.
+    bool use_lanes = Options::getInstance().useLanesHash();
+    std::vector<unsigned long long int> lanes(Options::hash_lanes_num, 0);
+    size_t lane_idx = 0;
+    size_t vals_number = Options::getInstance().getValsNumber();
+    size_t last_dim = dims.size() - 1;
+    int64_t axis_idx = arr->getMulValsAxisIdx();
+    bool axis_is_last = axis_idx == static_cast<int64_t>(last_dim);
+    std::vector<size_t> idx(dims.size(), 0);
+    while (true) {
+        bool row_written = written;
+        const uint8_t *last_dim_slice = nullptr;
+        for (auto &group : groups) {
+            size_t linear_idx = group.getLinearIdx(dims, idx);
+            if (group.dims_idx.back() == last_dim)
+                last_dim_slice = group.bitmap.data() + linear_idx;
+            else
+                row_written = row_written && group.bitmap.at(linear_idx);
         }
-        else {
-            hash(has_to_use_init_val || (i % cur_step != 0) ? init_val
-                                                            : cur_val);
+        bool row_use_main_vals =
+            axis_idx == -1 ||
+            (!axis_is_last &&
+             idx.at(axis_idx) % vals_number == Options::main_val_idx);
+
+        for (size_t i = 0; i < dims.at(last_dim); ++i) {
+            bool elem_written = row_written && last_dim_slice[i];
+            bool use_main_vals =
+                axis_is_last
+                    ? i % vals_number == Options::main_val_idx
+                    : row_use_main_vals;
+            if (!use_lanes)
+                hash(vals[elem_written][use_main_vals]);
+            else {
+                hashCombine(lanes[lane_idx], vals[elem_written][use_main_vals]);
+                lane_idx = (lane_idx + 1) % Options::hash_lanes_num;
+            }
         }
+
+        size_t i = last_dim;
+        while (i > 0 && ++idx.at(i - 1) == dims.at(i - 1))
+            idx.at(--i) = 0;
+        if (i == 0)
+            break;
     }
+
+    if (use_lanes)
+        for (auto lane : lanes)
+            hash(lane);
 }
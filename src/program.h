@@ -19,6 +19,7 @@ limitations under the License.
 #include "stmt.h"
 
 #include <memory>
+#include <unordered_map>
 
 namespace yarpgen {
 
@@ -28,26 +29,31 @@ class ProgramGenerator {
     void emit();
 
   private:
-    void emitCheckFunc(std::ostream &stream);
-    void emitDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitInit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitCheck(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitTest(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitMain(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
+    void emitCheckFunc(std::shared_ptr<EmitCtx> ctx, EmitStream &stream);
+    void emitDecl(std::shared_ptr<EmitCtx> ctx, EmitStream &stream);
+    void emitInit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream);
+    void emitCheck(std::shared_ptr<EmitCtx> ctx, EmitStream &stream);
+    void emitExtDecl(std::shared_ptr<EmitCtx> ctx, EmitStream &stream);
+    void emitTest(std::shared_ptr<EmitCtx> ctx, EmitStream &stream);
+    void emitMain(std::shared_ptr<EmitCtx> ctx, EmitStream &stream);
 
     std::shared_ptr<SymbolTable> ext_inp_sym_tbl;
     std::shared_ptr<SymbolTable> ext_out_sym_tbl;
     std::shared_ptr<ScopeStmt> new_test;
 
+    // This buffer tracks what input data we pass as a parameters to test
+    // functions
+    std::vector<std::string> pass_as_param_buffer;
+
     unsigned long long int hash_seed;
+    // The hash is pre-computed only if the output arrays are small enough
+    bool precompute_hash;
     void hash(unsigned long long int const v);
+    // Stores to the output arrays. They are used to model the final values
+    // of the arrays for hash pre-computation.
+    std::unordered_map<std::shared_ptr<Data>, ArrayStore> out_array_stores;
+    void collectOutArrayStores();
     void hashArray(std::shared_ptr<Array> const &arr);
-    void hashArrayStep(std::shared_ptr<Array> const &arr,
-                       std::vector<size_t> &dims, std::vector<size_t> &idx_vec,
-                       size_t cur_idx, bool has_to_use_init_val,
-                       uint64_t &init_val, uint64_t &cur_val,
-                       std::vector<size_t> &steps);
 };
 
 } // namespace yarpgen
@@ -0,0 +1,105 @@
+/*
+Copyright (c) 2015-2020, Intel Corporation
+Copyright (c) 2019-2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+#include "session.h"
+#include "expr.h"
+#include "type.h"
+
+#include <utility>
+
+using namespace yarpgen;
+
+static thread_local GenSession *current_session = nullptr;
+
+GenSession::GenSession(bool)
+    : options(), stats(), name_handler(), rand_gen(nullptr),
+      start_time(std::chrono::steady_clock::now()), budget_check_num(0),
+      budget_trip_point(0), array_type_uid_counter(0) {}
+
+GenSession::GenSession()
+    : options(getDefault().options), stats(), name_handler(),
+      rand_gen(nullptr), start_time(std::chrono::steady_clock::now()),
+      budget_check_num(0), budget_trip_point(0), array_type_uid_counter(0) {}
+
+GenSession &GenSession::getDefault() {
+    static GenSession default_session(true);
+    return default_session;
+}
+
+GenSession &GenSession::getCurrent() {
+    if (current_session)
+        return *current_session;
+    return getDefault();
+}
+
+void GenSession::setCurrent(GenSession *session) {
+    current_session = session;
+    rand_val_gen = getCurrent().rand_gen;
+}
+
+// The policy is reduced when a half of the budget is used, so the rest of the
+// test, the emission and the hashing of the arrays can fit into the other half
+static constexpr double BUDGET_SOFT_FRACTION = 0.5;
+
+bool GenSession::isNearBudget() {
+    // The checks are made in the same order in each run of the test until the
+    // budget is reached, so the number of the check is deterministic
+    budget_check_num++;
+
+    uint64_t max_compile_cost = options.getMaxCompileCost();
+    if (max_compile_cost != 0 &&
+        static_cast<double>(stats.getCompileCost()) >
+            static_cast<double>(max_compile_cost) * BUDGET_SOFT_FRACTION)
+        return true;
+
+    uint64_t max_dyn_ops = options.getMaxDynOps();
+    if (max_dyn_ops != 0 &&
+        static_cast<double>(stats.getDynOpsNum()) >
+            static_cast<double>(max_dyn_ops) * BUDGET_SOFT_FRACTION)
+        return true;
+
+    size_t max_gen_mem = options.getMaxGenMem();
+    if (max_gen_mem != 0 &&
+        static_cast<double>(stats.getIRSize()) >
+            static_cast<double>(max_gen_mem) * 1024 * 1024 *
+                BUDGET_SOFT_FRACTION)
+        return true;
+
+    size_t trip_point = options.getBudgetTripPoint();
+    if (trip_point != 0)
+        return budget_check_num >= trip_point;
+
+    size_t max_gen_time = options.getMaxGenTime();
+    if (max_gen_time == 0)
+        return false;
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start_time;
+    if (elapsed.count() <=
+        static_cast<double>(max_gen_time) * BUDGET_SOFT_FRACTION)
+        return false;
+    if (budget_trip_point == 0)
+        budget_trip_point = budget_check_num;
+    return true;
+}
+
+void GenSession::setRandValGen(std::shared_ptr<RandValGen> _rand_gen) {
+    rand_gen = std::move(_rand_gen);
+    if (&getCurrent() == this)
+        rand_val_gen = rand_gen;
+}
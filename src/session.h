@@ -0,0 +1,192 @@
+/*
+Copyright (c) 2015-2020, Intel Corporation
+Copyright (c) 2019-2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "hash.h"
+#include "options.h"
+#include "statistics.h"
+#include "utils.h"
+
+#include <chrono>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace yarpgen {
+
+class ArrayType;
+class ArrayUseExpr;
+class ConstantExpr;
+class Data;
+class IntegralType;
+class IterUseExpr;
+class ScalarVarUseExpr;
+
+// Generation session owns all of the state that is required to generate a
+// single test: options, random value generator, statistics, name counters,
+// and caches of the IR. Each thread has its own active session, so
+// independent tests can be generated concurrently in one process.
+// If no session was activated in the thread, the default one is used. It holds
+// the options that we've got from the command line, and every new session
+// starts with a copy of them.
+class GenSession {
+  public:
+    GenSession();
+    GenSession(const GenSession &) = delete;
+    GenSession &operator=(const GenSession &) = delete;
+
+    static GenSession &getCurrent();
+    // Pass nullptr to return to the default session
+    static void setCurrent(GenSession *session);
+
+    Options &getOptions() { return options; }
+    Statistics &getStatistics() { return stats; }
+
+    // Returns true if the generation has used a large part of its time, memory,
+    // dynamic operations or compile cost budget (see --max-gen-time,
+    // --max-gen-mem, --max-dyn-ops and --max-compile-cost). The memory budget
+    // is checked against the IR of the session. The time budget is not
+    // deterministic, so the check at which it was reached is recorded, and
+    // --budget-trip-point replays it instead of the wall clock.
+    bool isNearBudget();
+    // Number of the budget check at which the time budget was reached
+    // (zero if it wasn't)
+    size_t getBudgetTripPoint() { return budget_trip_point; }
+    NameHandler &getNameHandler() { return name_handler; }
+
+    std::shared_ptr<RandValGen> getRandValGen() { return rand_gen; }
+    void setRandValGen(std::shared_ptr<RandValGen> _rand_gen);
+
+    std::vector<std::shared_ptr<ConstantExpr>> &getUsedConsts() {
+        return used_consts;
+    }
+    std::unordered_map<std::shared_ptr<Data>,
+                       std::shared_ptr<ScalarVarUseExpr>> &
+    getScalarVarUseSet() {
+        return scalar_var_use_set;
+    }
+    std::unordered_map<std::shared_ptr<Data>, std::shared_ptr<ArrayUseExpr>> &
+    getArrayUseSet() {
+        return array_use_set;
+    }
+    std::unordered_map<std::shared_ptr<Data>, std::shared_ptr<IterUseExpr>> &
+    getIterUseSet() {
+        return iter_use_set;
+    }
+    std::unordered_map<IntTypeKey, std::shared_ptr<IntegralType>,
+                       IntTypeKeyHasher> &
+    getIntTypeSet() {
+        return int_type_set;
+    }
+    std::unordered_map<ArrayTypeKey, std::shared_ptr<ArrayType>,
+                       ArrayTypeKeyHasher> &
+    getArrayTypeSet() {
+        return array_type_set;
+    }
+    size_t getNextArrayTypeUID() { return array_type_uid_counter++; }
+
+  private:
+    // Constructor for the default session
+    explicit GenSession(bool);
+    static GenSession &getDefault();
+
+    Options options;
+    Statistics stats;
+    NameHandler name_handler;
+    std::shared_ptr<RandValGen> rand_gen;
+    std::chrono::steady_clock::time_point start_time;
+    size_t budget_check_num;
+    size_t budget_trip_point;
+
+    // Buffer of constants that we can reuse
+    std::vector<std::shared_ptr<ConstantExpr>> used_consts;
+    // Uses of variables are unique for each variable
+    std::unordered_map<std::shared_ptr<Data>, std::shared_ptr<ScalarVarUseExpr>>
+        scalar_var_use_set;
+    std::unordered_map<std::shared_ptr<Data>, std::shared_ptr<ArrayUseExpr>>
+        array_use_set;
+    std::unordered_map<std::shared_ptr<Data>, std::shared_ptr<IterUseExpr>>
+        iter_use_set;
+
+    // Folding sets of the types
+    std::unordered_map<IntTypeKey, std::shared_ptr<IntegralType>,
+                       IntTypeKeyHasher>
+        int_type_set;
+    std::unordered_map<ArrayTypeKey, std::shared_ptr<ArrayType>,
+                       ArrayTypeKeyHasher>
+        array_type_set;
+    size_t array_type_uid_counter;
+};
+
+// Detects the IR nodes that have a kind (expressions and statements)
+template <typename T, typename = void>
+struct HasIRNodeKind : std::false_type {};
+template <typename T>
+struct HasIRNodeKind<T, std::void_t<decltype(std::declval<T &>().getKind())>>
+    : std::is_same<decltype(std::declval<T &>().getKind()), IRNodeKind> {};
+
+// Allocator of the IR nodes that counts the live bytes of the IR. It keeps
+// the statistics of the session that created the node, so the node can be
+// freed after the current session was changed.
+template <typename T> class IRNodeAllocator {
+  public:
+    using value_type = T;
+
+    explicit IRNodeAllocator(Statistics &_stats) : stats(&_stats) {}
+    template <typename U>
+    IRNodeAllocator(const IRNodeAllocator<U> &other) : stats(other.stats) {}
+
+    T *allocate(size_t n) {
+        T *ret = std::allocator<T>().allocate(n);
+        stats->addIRSize(n * sizeof(T));
+        return ret;
+    }
+    void deallocate(T *ptr, size_t n) {
+        stats->subIRSize(n * sizeof(T));
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator==(const IRNodeAllocator<U> &other) const {
+        return stats == other.stats;
+    }
+    template <typename U>
+    bool operator!=(const IRNodeAllocator<U> &other) const {
+        return stats != other.stats;
+    }
+
+  private:
+    template <typename U> friend class IRNodeAllocator;
+    Statistics *stats;
+};
+
+// Replacement for std::make_shared that is used for all of the IR nodes
+template <typename T, typename... Args>
+std::shared_ptr<T> makeIRNode(Args &&...args) {
+    Statistics &stats = Statistics::getInstance();
+    auto ret = std::allocate_shared<T>(IRNodeAllocator<T>(stats),
+                                       std::forward<Args>(args)...);
+    if constexpr (HasIRNodeKind<T>::value)
+        stats.addNode(ret->getKind());
+    return ret;
+}
+} // namespace yarpgen
@@ -16,5 +16,83 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 
 #include "statistics.h"
+#include "options.h"
+#include "session.h"
+#include "utils.h"
+
+#include <fstream>
+#include <vector>
 
 using namespace yarpgen;
+
+Statistics &Statistics::getInstance() {
+    return GenSession::getCurrent().getStatistics();
+}
+
+bool Statistics::phase_timing_enabled = false;
+
+// Names of the enum values for the dump. Empty names are skipped.
+static const std::vector<std::string> ub_kind_names = {
+    "NoUB", "Uninit", "SignOvf", "SignOvfMin", "ZeroDiv", "ShiftRhsNeg",
+    "ShiftRhsLarge", "NegShift", "NoMember", "OutOfBounds"};
+static const std::vector<std::string> node_kind_names = {
+    "CONST", "SCALAR_VAR_USE", "ITER_USE", "ARRAY_USE", "SUBSCRIPT",
+    "TYPE_CAST", "ASSIGN", "REDUCTION", "UNARY", "BINARY", "TERNARY", "CALL",
+    /*MAX_EXPR_KIND*/ "", "EXPR", "DECL", "BLOCK", "SCOPE", "LOOP_SEQ",
+    "LOOP_NEST", "IF_ELSE", "STUB"};
+static const std::vector<std::string> phase_names = {
+    "generate_structure", "populate", "propagate_type", "rebuild", "emit"};
+
+template <typename T, size_t N>
+static void dumpCounters(std::ostream &stream, const std::string &name,
+                         const std::array<T, N> &counters,
+                         const std::vector<std::string> &names) {
+    if (names.size() != N)
+        ERROR("Names of the counters don't match them");
+    stream << "    \"" << name << "\": {";
+    bool first = true;
+    for (size_t i = 0; i < N; ++i) {
+        if (names.at(i).empty())
+            continue;
+        stream << (first ? "" : ",") << "\n        \"" << names.at(i)
+               << "\": " << counters.at(i);
+        first = false;
+    }
+    stream << "\n    },\n";
+}
+
+void Statistics::dump(std::ostream &stream) {
+    stream << "{\n";
+    stream << "    \"seed\": " << Options::getInstance().getSeed() << ",\n";
+
+    stream << "    \"phases\": {";
+    for (size_t i = 0; i < PHASE_NUM; ++i) {
+        double time_ms = std::chrono::duration<double, std::milli>(
+                             phase_time.at(i))
+                             .count();
+        stream << (i == 0 ? "" : ",") << "\n        \"" << phase_names.at(i)
+               << "\": {\"time_ms\": " << time_ms
+               << ", \"calls\": " << phase_calls.at(i) << "}";
+    }
+    stream << "\n    },\n";
+
+    dumpCounters(stream, "nodes", node_num, node_kind_names);
+    stream << "    \"implicit_convs\": " << implicit_conv_num << ",\n";
+    dumpCounters(stream, "ub_fixes", ub_num, ub_kind_names);
+    stream << "    \"stmt_num\": " << stmt_num << ",\n";
+    stream << "    \"gen_policy_copies\": " << gen_policy_copy_num << ",\n";
+    stream << "    \"peak_ir_size\": " << peak_ir_size << ",\n";
+    stream << "    \"budget_limits\": " << budget_limit_num << ",\n";
+    stream << "    \"dyn_ops\": " << dyn_ops_num << ",\n";
+    stream << "    \"compile_cost\": " << compile_cost << "\n";
+    stream << "}\n";
+}
+
+void Statistics::dumpToFile(const std::string &file_name) {
+    std::ofstream out_file(file_name);
+    if (!out_file)
+        ERROR(std::string("Can't open file ") + file_name);
+    dump(out_file);
+    if (!out_file)
+        ERROR(std::string("Can't write file ") + file_name);
+}
@@ -17,30 +17,157 @@ limitations under the License.
 #pragma once
 
 #include "enums.h"
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <ostream>
+#include <string>
 
 namespace yarpgen {
 class Statistics {
   public:
-    static Statistics &getInstance() {
-        static Statistics instance;
-        return instance;
-    }
+    static Statistics &getInstance();
     Statistics(const Statistics &options) = delete;
     Statistics &operator=(const Statistics &) = delete;
 
     void addStmt(size_t val = 1) { stmt_num += val; }
     size_t getStmtNum() { return stmt_num; }
 
+    // Each fix of undefined behavior during the rebuild
     void addUB(UBKind kind) { ub_num.at(static_cast<size_t>(kind))++; }
+    void addNode(IRNodeKind kind) { node_num.at(static_cast<size_t>(kind))++; }
+    // Implicit conversions are recorded on the operands instead of the nodes
+    void addImplicitConv() { implicit_conv_num++; }
+    void addGenPolicyCopy() { gen_policy_copy_num++; }
+    // Size of the live IR nodes (in bytes) and its high-water mark. The
+    // counters are updated by the allocator of the nodes, see makeIRNode.
+    void addIRSize(size_t val) {
+        ir_size += val;
+        peak_ir_size = std::max(peak_ir_size, ir_size);
+    }
+    void subIRSize(size_t val) {
+        assert(ir_size >= val && "IR size underflow");
+        ir_size -= val;
+    }
+    size_t getIRSize() { return ir_size; }
+    size_t getPeakIRSize() { return peak_ir_size; }
+    // Each time the policy was reduced to fit into the generation budget
+    void addBudgetLimit() { budget_limit_num++; }
+    size_t getBudgetLimitNum() { return budget_limit_num; }
+
+    // Estimate of the number of operations that the test executes
+    void addDynOps(uint64_t val) { dyn_ops_num += val; }
+    uint64_t getDynOpsNum() { return dyn_ops_num; }
+    // Estimate of the work that the compiler does for the test. It is measured
+    // in the weighted IR nodes, see the weights below.
+    void addCompileCost(uint64_t val) { compile_cost += val; }
+    uint64_t getCompileCost() { return compile_cost; }
+    // Expression nodes that were created so far. Implicit conversions are
+    // counted as well, because they are still operations of the test.
+    size_t getExprNodeNum() {
+        size_t ret = implicit_conv_num;
+        for (size_t i = 0; i < static_cast<size_t>(IRNodeKind::MAX_EXPR_KIND);
+             ++i)
+            ret += node_num.at(i);
+        return ret;
+    }
+
+    // Phase timing has a cost, so it is enabled only if we dump the stats.
+    // The option is the same for all of the sessions.
+    static void setPhaseTimingEnabled(bool val) { phase_timing_enabled = val; }
+    static bool isPhaseTimingEnabled() { return phase_timing_enabled; }
+
+    // Phases can be called recursively, so only the outermost call is timed.
+    // Returns false if the phase is already active.
+    bool enterPhase(GenPhase phase) {
+        auto idx = static_cast<size_t>(phase);
+        if (phase_active.at(idx))
+            return false;
+        phase_active.at(idx) = true;
+        return true;
+    }
+    void exitPhase(GenPhase phase, std::chrono::steady_clock::duration time) {
+        auto idx = static_cast<size_t>(phase);
+        phase_active.at(idx) = false;
+        phase_time.at(idx) += time;
+        phase_calls.at(idx)++;
+    }
+
+    // Writes the statistics in JSON format
+    void dump(std::ostream &stream);
+    void dumpToFile(const std::string &file_name);
 
   private:
-    Statistics() : stmt_num(0), ub_num({}) {}
+    friend class GenSession;
+    Statistics()
+        : stmt_num(0), ub_num({}), node_num({}), implicit_conv_num(0),
+          gen_policy_copy_num(0), ir_size(0), peak_ir_size(0),
+          budget_limit_num(0), dyn_ops_num(0), compile_cost(0),
+          phase_active({}), phase_time({}), phase_calls({}) {}
+
+    static constexpr size_t UB_KIND_NUM = static_cast<size_t>(UBKind::MaxUB);
+    static constexpr size_t NODE_KIND_NUM =
+        static_cast<size_t>(IRNodeKind::MAX_STMT_KIND);
+    static constexpr size_t PHASE_NUM =
+        static_cast<size_t>(GenPhase::MAX_GEN_PHASE);
 
     size_t stmt_num;
-    // TODO: count undefined behavior stats
-    std::array<size_t, static_cast<size_t>(UBKind::MaxUB)> ub_num;
+    std::array<size_t, UB_KIND_NUM> ub_num;
+    // IR nodes that were created (including the copies and the discarded ones)
+    std::array<size_t, NODE_KIND_NUM> node_num;
+    size_t implicit_conv_num;
+    size_t gen_policy_copy_num;
+    size_t ir_size;
+    size_t peak_ir_size;
+    size_t budget_limit_num;
+    uint64_t dyn_ops_num;
+    uint64_t compile_cost;
+
+    std::array<bool, PHASE_NUM> phase_active;
+    std::array<std::chrono::steady_clock::duration, PHASE_NUM> phase_time;
+    std::array<size_t, PHASE_NUM> phase_calls;
+
+    static bool phase_timing_enabled;
+};
+
+// Weights of the compile cost estimate. An expression node costs one unit for
+// each enclosing loop plus one, and its cost is multiplied by the code growth
+// of the loop pragmas. Stencils are counted through their subscript nodes.
+constexpr uint64_t LOOP_COMPILE_COST = 20;
+constexpr uint64_t ARRAY_COMPILE_COST = 10;
+// The compiler unrolls the loop with the pragma up to this factor
+constexpr uint64_t UNROLL_COMPILE_FACTOR = 8;
+// Vectorization creates a vector body and a scalar remainder
+constexpr uint64_t VECTORIZE_COMPILE_FACTOR = 2;
+
+// Measures wall time of a phase of the generation within its scope. Phases
+// can be nested (e.g., rebuild calls propagateType), and the time of a phase
+// includes the time of the phases that are nested into it.
+class PhaseTimer {
+  public:
+    explicit PhaseTimer(GenPhase _phase) : phase(_phase), stats(nullptr) {
+        if (!Statistics::isPhaseTimingEnabled())
+            return;
+        Statistics &cur_stats = Statistics::getInstance();
+        if (!cur_stats.enterPhase(phase))
+            return;
+        stats = &cur_stats;
+        start = std::chrono::steady_clock::now();
+    }
+    ~PhaseTimer() {
+        if (stats)
+            stats->exitPhase(phase, std::chrono::steady_clock::now() - start);
+    }
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+  private:
+    GenPhase phase;
+    Statistics *stats;
+    std::chrono::steady_clock::time_point start;
 };
 
 } // namespace yarpgen
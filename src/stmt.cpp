@@ -26,31 +26,65 @@ limitations under the License.
 
 using namespace yarpgen;
 
-void ExprStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset) {
-    stream << offset;
+void ExprStmt::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                    size_t offset) {
+    stream.indent(offset);
     expr->emit(ctx, stream);
     stream << ";";
 }
 
+void ExprStmt::collectArrayStores(
+    std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+    std::vector<ArrayStore> &stores) {
+    if (expr->getKind() != IRNodeKind::ASSIGN &&
+        expr->getKind() != IRNodeKind::REDUCTION)
+        return;
+    auto assign_expr = std::static_pointer_cast<AssignmentExpr>(expr);
+    if (!assign_expr->isTaken() ||
+        assign_expr->getTo()->getKind() != IRNodeKind::SUBSCRIPT)
+        return;
+    auto subs = std::static_pointer_cast<SubscriptExpr>(assign_expr->getTo());
+    stores.push_back({subs, enclosing_loops});
+}
+
 std::shared_ptr<ExprStmt> ExprStmt::create(std::shared_ptr<PopulateCtx> ctx) {
     auto gen_pol = ctx->getGenPolicy();
 
     auto new_active_ctx = std::make_shared<PopulateCtx>(*ctx);
 
+    Statistics &stats = Statistics::getInstance();
+    size_t expr_node_num = stats.getExprNodeNum();
+
     std::shared_ptr<AssignmentExpr> expr;
     int64_t total_iters_num =
         std::accumulate(new_active_ctx->getLocalSymTable()->getIters().begin(),
-                        new_active_ctx->getLocalSymTable()->getIters().end(), 1,
+                        new_active_ctx->getLocalSymTable()->getIters().end(),
+                        static_cast<size_t>(1),
                         [](size_t a, const std::shared_ptr<Iterator> &b) {
                             return a * b->getTotalItersNum();
                         });
 
+    // Reductions are evaluated in a closed form, so the size of the iteration
+    // space doesn't limit them. The first version of the seeds still doesn't
+    // create them in large iteration spaces, so the seeds produce the same
+    // tests as before. The number of iterations is accumulated in int there,
+    // exactly as it used to be.
+    bool large_iter_space = false;
+    if (rand_val_gen->getSeedVersion() == SeedVersion::V1) {
+        int legacy_iters_num = std::accumulate(
+            new_active_ctx->getLocalSymTable()->getIters().begin(),
+            new_active_ctx->getLocalSymTable()->getIters().end(), 1,
+            [](size_t a, const std::shared_ptr<Iterator> &b) {
+                return a * b->getTotalItersNum();
+            });
+        large_iter_space =
+            static_cast<int64_t>(legacy_iters_num) >
+            static_cast<int64_t>(ITERATIONS_THRESHOLD_FOR_REDUCTION);
+    }
+
     // TODO: relax constraints on reduction expressions
     auto expr_kind =
-        (total_iters_num >
-             static_cast<int64_t>(ITERATIONS_THRESHOLD_FOR_REDUCTION) ||
-         ctx->isInsideForeach())
+        (large_iter_space || ctx->isInsideForeach())
             ? IRNodeKind::ASSIGN
             : rand_val_gen->getRandId(gen_pol->expr_stmt_kind_pop_distr);
 
@@ -67,8 +101,10 @@ std::shared_ptr<ExprStmt> ExprStmt::create(std::shared_ptr<PopulateCtx> ctx) {
     EvalCtx eval_ctx;
     eval_ctx.total_iter_num = total_iters_num;
     auto eval_res = expr->evaluate(eval_ctx);
-    if (eval_res->hasUB())
+    if (eval_res->hasUB()) {
+        PhaseTimer timer(GenPhase::REBUILD);
         expr->rebuild(eval_ctx);
+    }
     expr->propagateValue(eval_ctx);
     if (new_active_ctx->getAllowMulVals()) {
         eval_ctx.mul_vals_iter = new_active_ctx->getMulValsIter();
@@ -77,18 +113,32 @@ std::shared_ptr<ExprStmt> ExprStmt::create(std::shared_ptr<PopulateCtx> ctx) {
     }
 
     if (eval_res->hasUB()) {
+        PhaseTimer timer(GenPhase::REBUILD);
         expr->rebuild(eval_ctx);
     }
 
     if (new_active_ctx->getAllowMulVals())
         expr->propagateValue(eval_ctx);
 
-    return std::make_shared<ExprStmt>(expr);
+    // Each iteration of the enclosing loops executes every node of the
+    // expression. The nodes that were replaced by the rebuild are counted as
+    // well, which is fine for an estimate.
+    size_t new_expr_node_num = stats.getExprNodeNum() - expr_node_num;
+    if (ctx->isTaken()) {
+        uint64_t iters_num = 1;
+        for (const auto &iter : ctx->getLocalSymTable()->getIters())
+            iters_num *= iter->getTotalItersNum();
+        stats.addDynOps(iters_num * new_expr_node_num);
+    }
+    stats.addCompileCost(new_expr_node_num * ctx->getCompileCostFactor() *
+                         (1 + ctx->getLoopDepth()));
+
+    return makeIRNode<ExprStmt>(expr);
 }
 
-void DeclStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset) {
-    stream << offset;
+void DeclStmt::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                    size_t offset) {
+    stream.indent(offset);
     // TODO: we need to do the right thing here
     stream << data->getType()->getName(ctx) << " ";
     stream << data->getName(ctx);
@@ -99,8 +149,8 @@ void DeclStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     stream << ";";
 }
 
-void StmtBlock::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                     std::string offset) {
+void StmtBlock::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                     size_t offset) {
     for (const auto &stmt : stmts) {
         stmt->emit(ctx, stream, offset);
         // TODO: will that work if we have suffix?
@@ -110,6 +160,20 @@ void StmtBlock::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     }
 }
 
+// When the generation nears its budget, the rest of the test in the context is
+// generated with the reduced policy. The nested contexts inherit it.
+static void checkGenBudget(const std::shared_ptr<GenCtx> &ctx) {
+    auto gen_policy = ctx->getGenPolicy();
+    if (gen_policy->isBudgetLimited() ||
+        !GenSession::getCurrent().isNearBudget())
+        return;
+    Statistics &stats = Statistics::getInstance();
+    stats.addBudgetLimit();
+    auto new_policy = std::make_shared<GenPolicy>(*gen_policy);
+    new_policy->applyBudgetLimits(stats.getStmtNum(), ctx->getLoopDepth());
+    ctx->setGenPolicy(new_policy);
+}
+
 std::shared_ptr<StmtBlock>
 StmtBlock::generateStructure(std::shared_ptr<GenCtx> ctx) {
     std::vector<std::shared_ptr<Stmt>> stmts;
@@ -122,6 +186,8 @@ StmtBlock::generateStructure(std::shared_ptr<GenCtx> ctx) {
 
     std::shared_ptr<Stmt> new_stmt;
     for (size_t i = 0; i < stmt_num; ++i) {
+        checkGenBudget(ctx);
+        gen_policy = ctx->getGenPolicy();
         IRNodeKind stmt_kind =
             rand_val_gen->getRandId(gen_policy->stmt_kind_struct_distr);
 
@@ -156,13 +222,12 @@ StmtBlock::generateStructure(std::shared_ptr<GenCtx> ctx) {
         stmts.push_back(new_stmt);
     }
 
-    return std::make_shared<StmtBlock>(stmts);
+    return makeIRNode<StmtBlock>(stmts);
 }
 
 void StmtBlock::populate(std::shared_ptr<PopulateCtx> ctx) {
-    auto gen_pol = ctx->getGenPolicy();
-
     for (auto &stmt : stmts) {
+        checkGenBudget(ctx);
         if (stmt->getKind() != IRNodeKind::STUB)
             stmt->populate(ctx);
         else
@@ -170,32 +235,32 @@ void StmtBlock::populate(std::shared_ptr<PopulateCtx> ctx) {
     }
 }
 
-void ScopeStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                     std::string offset) {
-    stream << offset << "{\n";
-    StmtBlock::emit(ctx, stream, offset + "    ");
-    stream << offset << "}\n";
+void ScopeStmt::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                     size_t offset) {
+    stream.indent(offset) << "{\n";
+    StmtBlock::emit(ctx, stream, offset + 1);
+    stream.indent(offset) << "}\n";
 }
 
 std::shared_ptr<ScopeStmt>
 ScopeStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
     // TODO: will that work?
-    auto new_scope = std::make_shared<ScopeStmt>();
+    auto new_scope = makeIRNode<ScopeStmt>();
     auto stmt_block = StmtBlock::generateStructure(std::move(ctx));
     new_scope->stmts = stmt_block->getStmts();
     return new_scope;
 }
 
-void LoopHead::emitPrefix(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void LoopHead::emitPrefix(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                          size_t offset) {
     if (prefix.use_count() != 0)
-        prefix->emit(ctx, stream, std::move(offset));
+        prefix->emit(ctx, stream, offset);
 }
 
-void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                          size_t offset) {
     if (vectorizable)
-        stream << offset << "/* vectorizable */\n";
+        stream.indent(offset) << "/* vectorizable */\n";
     if (!pragmas.empty()) {
         for (auto &pragma : pragmas) {
             pragma->emit(ctx, stream, offset);
@@ -203,7 +268,7 @@ void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
         }
     }
 
-    stream << offset;
+    stream.indent(offset);
 
     auto place_sep = [this](auto iter, std::string sep) -> std::string {
         return iter != iters.end() - 1 ? std::move(sep) : "";
@@ -285,10 +350,10 @@ void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
         stream << "/* same iter space */";
 }
 
-void LoopHead::emitSuffix(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void LoopHead::emitSuffix(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                          size_t offset) {
     if (suffix.use_count() != 0)
-        suffix->emit(ctx, stream, std::move(offset));
+        suffix->emit(ctx, stream, offset);
 }
 
 void LoopHead::createPragmas(std::shared_ptr<PopulateCtx> ctx) {
@@ -312,10 +377,49 @@ bool LoopHead::hasSIMDPragma() {
            pragmas.end();
 }
 
+uint64_t LoopHead::getCompileCostFactor() {
+    uint64_t unroll_factor = 1;
+    uint64_t vectorize_factor = 1;
+    for (const auto &pragma : pragmas) {
+        switch (pragma->getKind()) {
+            case PragmaKind::CLANG_UNROLL:
+                unroll_factor = std::min(
+                    UNROLL_COMPILE_FACTOR,
+                    static_cast<uint64_t>(iters.front()->getTotalItersNum()));
+                break;
+            // All of them lead to a single vectorized version of the loop
+            case PragmaKind::CLANG_VECTORIZE:
+            case PragmaKind::CLANG_INTERLEAVE:
+            case PragmaKind::CLANG_VEC_PREDICATE:
+            case PragmaKind::OMP_SIMD:
+                vectorize_factor = VECTORIZE_COMPILE_FACTOR;
+                break;
+            case PragmaKind::MAX_PRAGMA_KIND:
+                ERROR("Bad PragmaKind");
+        }
+    }
+    return std::max(unroll_factor, static_cast<uint64_t>(1)) *
+           vectorize_factor;
+}
+
+// Accounts the compile cost of the loop and of the code growth of its pragmas.
+// The growth of the nested loops doesn't multiply, because the compilers
+// unroll and vectorize only one level of the nest.
+static void addLoopCompileCost(const std::shared_ptr<PopulateCtx> &ctx,
+                               const std::shared_ptr<LoopHead> &loop_head) {
+    ctx->setCompileCostFactor(std::max(ctx->getCompileCostFactor(),
+                                       loop_head->getCompileCostFactor()));
+    Statistics::getInstance().addCompileCost(LOOP_COMPILE_COST *
+                                             ctx->getCompileCostFactor());
+}
+
 void LoopHead::populateArrays(std::shared_ptr<PopulateCtx> ctx) {
     auto gen_pol = ctx->getGenPolicy();
     size_t new_arrays_num = rand_val_gen->getRandId(gen_pol->new_arr_num_distr);
     for (size_t i = 0; i < new_arrays_num; ++i) {
+        // Arrays are the largest part of the test, so we check the budget
+        // before each of them
+        checkGenBudget(ctx);
         ctx->getExtInpSymTable()->addArray(Array::create(ctx, true));
     }
 }
@@ -331,10 +435,9 @@ LoopHead::populateIterators(std::shared_ptr<PopulateCtx> ctx, size_t _end_val) {
     return new_iter;
 }
 
-void LoopSeqStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                       std::string offset) {
-    stream << offset << "/* LoopSeq " << std::to_string(loops.size())
-           << " */\n";
+void LoopSeqStmt::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                       size_t offset) {
+    stream.indent(offset) << "/* LoopSeq " << loops.size() << " */\n";
 
     for (const auto &loop : loops) {
         loop.first->emitPrefix(ctx, stream, offset);
@@ -345,6 +448,22 @@ void LoopSeqStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     }
 }
 
+void LoopSeqStmt::collectArrayStores(
+    std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+    std::vector<ArrayStore> &stores) {
+    for (const auto &loop : loops) {
+        if (loop.first->getPrefix().use_count() != 0)
+            loop.first->getPrefix()->collectArrayStores(enclosing_loops,
+                                                        stores);
+        enclosing_loops.push_back(loop.first);
+        loop.second->collectArrayStores(enclosing_loops, stores);
+        enclosing_loops.pop_back();
+        if (loop.first->getSuffix().use_count() != 0)
+            loop.first->getSuffix()->collectArrayStores(enclosing_loops,
+                                                        stores);
+    }
+}
+
 std::shared_ptr<LoopSeqStmt>
 LoopSeqStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
     auto gen_pol = ctx->getGenPolicy();
@@ -352,13 +471,13 @@ LoopSeqStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
 
     Options &options = Options::getInstance();
 
-    auto new_loop_seq = std::make_shared<LoopSeqStmt>();
+    auto new_loop_seq = makeIRNode<LoopSeqStmt>();
     auto new_ctx = std::make_shared<GenCtx>(*ctx);
     // TODO: is it the right place to do it?
     new_ctx->incLoopDepth(1);
     for (size_t i = 0; i < loop_num; ++i) {
         bool gen_foreach = false;
-        auto new_loop_head = std::make_shared<LoopHead>();
+        auto new_loop_head = makeIRNode<LoopHead>();
 
         if (options.isISPC())
             gen_foreach = !ctx->isInsideForeach() &&
@@ -455,7 +574,7 @@ void LoopSeqStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
             auto prev_loop = loops.at(cur_idx - 1);
             auto prev_iter = prev_loop.first->getIterators().front();
             NameHandler &nh = NameHandler::getInstance();
-            new_iters = std::make_shared<Iterator>(
+            new_iters = makeIRNode<Iterator>(
                 nh.getIterName(), prev_iter->getType(), prev_iter->getStart(),
                 prev_iter->getMaxLeftOffset(), prev_iter->getEnd(),
                 prev_iter->getMaxRightOffset(), prev_iter->getStep(),
@@ -487,6 +606,7 @@ void LoopSeqStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
         }
 
         new_ctx->addDimension(new_dim);
+        addLoopCompileCost(new_ctx, loop_head);
         LoopHead::populateArrays(new_ctx);
 
         new_ctx->getLocalSymTable()->addIters(new_iters);
@@ -528,26 +648,46 @@ void LoopSeqStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
     }
 }
 
-void LoopNestStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                        std::string offset) {
-    stream << offset << "/* LoopNest " << std::to_string(loops.size())
-           << " */\n";
+void LoopNestStmt::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                        size_t offset) {
+    stream.indent(offset) << "/* LoopNest " << loops.size() << " */\n";
 
-    std::string new_offset = offset;
+    size_t new_offset = offset;
     for (const auto &loop : loops) {
         loop->emitPrefix(ctx, stream, new_offset);
         loop->emitHeader(ctx, stream, new_offset);
-        stream << "\n" << new_offset << "{\n";
-        new_offset += "    ";
+        stream << "\n";
+        stream.indent(new_offset) << "{\n";
+        new_offset++;
     }
 
     body->emit(ctx, stream, new_offset);
-    new_offset.erase(new_offset.size() - 4, 4);
+    new_offset--;
 
     for (const auto &loop : loops) {
-        stream << new_offset << "} \n";
+        stream.indent(new_offset) << "} \n";
         loop->emitSuffix(ctx, stream, new_offset);
-        new_offset.erase(new_offset.size() - 4, 4);
+        new_offset--;
+    }
+}
+
+void LoopNestStmt::collectArrayStores(
+    std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+    std::vector<ArrayStore> &stores) {
+    for (const auto &loop : loops) {
+        if (loop->getPrefix().use_count() != 0)
+            loop->getPrefix()->collectArrayStores(enclosing_loops, stores);
+        enclosing_loops.push_back(loop);
+    }
+
+    body->collectArrayStores(enclosing_loops, stores);
+
+    // Suffixes are emitted in the order of the loops, but the innermost loop
+    // is closed first (see emit())
+    for (const auto &loop : loops) {
+        enclosing_loops.pop_back();
+        if (loop->getSuffix().use_count() != 0)
+            loop->getSuffix()->collectArrayStores(enclosing_loops, stores);
     }
 }
 
@@ -562,10 +702,10 @@ LoopNestStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
 
     Options &options = Options::getInstance();
 
-    auto new_loop_nest = std::make_shared<LoopNestStmt>();
+    auto new_loop_nest = makeIRNode<LoopNestStmt>();
     auto new_ctx = std::make_shared<GenCtx>(*ctx);
     for (size_t i = 0; i < nest_depth; ++i) {
-        auto new_loop = std::make_shared<LoopHead>();
+        auto new_loop = makeIRNode<LoopHead>();
 
         bool gen_foreach = false;
         if (options.isISPC())
@@ -595,6 +735,9 @@ void LoopNestStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
     auto taken_switch_id = loops.end();
     auto simd_switch_id = loops.end();
     auto mul_val_loop_idx = loops.end();
+    // Compile cost factors outside of each loop. They are restored along with
+    // the dimensions, so the suffixes get the factor of their enclosing loops.
+    std::vector<uint64_t> outer_cost_factors;
     for (auto i = loops.begin(); i != loops.end(); ++i) {
         if ((*i)->getPrefix().use_count() != 0) {
             (*i)->getPrefix()->populate(new_ctx);
@@ -636,6 +779,8 @@ void LoopNestStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
         }
 
         new_ctx->addDimension(new_dim);
+        outer_cost_factors.push_back(new_ctx->getCompileCostFactor());
+        addLoopCompileCost(new_ctx, *i);
         LoopHead::populateArrays(new_ctx);
 
         new_ctx->getLocalSymTable()->addIters(new_iters);
@@ -653,6 +798,8 @@ void LoopNestStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
         new_ctx->decLoopDepth(1);
         new_ctx->getLocalSymTable()->deleteLastIters();
         new_ctx->deleteLastDim();
+        new_ctx->setCompileCostFactor(outer_cost_factors.back());
+        outer_cost_factors.pop_back();
         if (i == mul_val_loop_idx) {
             new_ctx->setMulValsIter(nullptr);
             new_ctx->setAllowMulVals(false);
@@ -668,16 +815,16 @@ void LoopNestStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
     }
 }
 
-void IfElseStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                      std::string offset) {
-    stream << offset << "if (";
+void IfElseStmt::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                      size_t offset) {
+    stream.indent(offset) << "if (";
     // We can dump test structure before populating it
     if (cond.use_count() != 0)
         cond->emit(ctx, stream);
     stream << ")\n";
     then_br->emit(ctx, stream, offset);
     if (else_br.use_count() != 0) {
-        stream << offset << "else\n";
+        stream.indent(offset) << "else\n";
         else_br->emit(ctx, stream, offset);
     }
 }
@@ -696,7 +843,7 @@ IfElseStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
     Statistics &stats = Statistics::getInstance();
     stats.addStmt();
 
-    return std::make_shared<IfElseStmt>(nullptr, then_br, else_br);
+    return makeIRNode<IfElseStmt>(nullptr, then_br, else_br);
 }
 
 void IfElseStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
@@ -714,7 +861,7 @@ void IfElseStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
     std::shared_ptr<IntegralType> int_type =
         std::static_pointer_cast<IntegralType>(cond->getValue()->getType());
     if (int_type->getIntTypeId() != IntTypeID::BOOL) {
-        cond = std::make_shared<TypeCastExpr>(
+        cond = makeIRNode<TypeCastExpr>(
             cond,
             IntegralType::init(IntTypeID::BOOL, false, CVQualifier::NONE,
                                cond->getValue()->getType()->isUniform()),
@@ -738,20 +885,20 @@ void IfElseStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
     }
 }
 
-void StubStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset) {
-    stream << offset << text;
+void StubStmt::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                    size_t offset) {
+    stream.indent(offset) << text;
 }
 
 std::shared_ptr<StubStmt>
 StubStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
     NameHandler &nh = NameHandler::getInstance();
-    return std::make_shared<StubStmt>("Stub stmt #" + nh.getStubStmtIdx());
+    return makeIRNode<StubStmt>("Stub stmt #" + nh.getStubStmtIdx());
 }
 
-void Pragma::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                  std::string offset) {
-    stream << offset << "#pragma ";
+void Pragma::emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                  size_t offset) {
+    stream.indent(offset) << "#pragma ";
     auto clang_emit_helper = [&stream](std::string name) {
         stream << "clang loop " << name << "(enable)";
     };
@@ -783,7 +930,7 @@ std::shared_ptr<Pragma> Pragma::create(std::shared_ptr<PopulateCtx> ctx) {
         rand_val_gen->getRandId(gen_pol->pragma_kind_distr);
     if (pragma_kind == PragmaKind::MAX_PRAGMA_KIND)
         ERROR("Bad PragmaKind");
-    return std::make_shared<Pragma>(pragma_kind);
+    return makeIRNode<Pragma>(pragma_kind);
 }
 
 std::vector<std::shared_ptr<Pragma>>
@@ -797,7 +944,7 @@ Pragma::create(size_t num, std::shared_ptr<PopulateCtx> ctx) {
         auto search_func = [&_kind](Probability<PragmaKind> &elem) -> bool {
             return elem.getId() == _kind;
         };
-        auto &vec = tmp_gen_pol->pragma_kind_distr;
+        auto &vec = tmp_gen_pol->pragma_kind_distr.getMutable();
         vec.erase(std::remove_if(vec.begin(), vec.end(), search_func),
                   vec.end());
     };
@@ -28,9 +28,18 @@ limitations under the License.
 #include <memory>
 #include <numeric>
 #include <utility>
+#include <vector>
 
 namespace yarpgen {
 
+class LoopHead;
+
+// Store to an array and the loops that enclose it (from the outermost one)
+struct ArrayStore {
+    std::shared_ptr<SubscriptExpr> subs;
+    std::vector<std::shared_ptr<LoopHead>> loops;
+};
+
 class Stmt : public IRNode {
   public:
     virtual IRNodeKind getKind() { return IRNodeKind::MAX_STMT_KIND; }
@@ -38,6 +47,12 @@ class Stmt : public IRNode {
     // about the number of iterations. Those two decisions are made in
     // different places, so we need to have a way to communicate this
     virtual bool detectNestedForeach() { return false; }
+    // Collects the taken stores to the arrays. We need them to model the final
+    // values of the output arrays. Loops that enclose the statement are
+    // passed in the order of nesting, and they match the emitted code.
+    virtual void
+    collectArrayStores(std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+                       std::vector<ArrayStore> &stores) {}
 };
 
 class ExprStmt : public Stmt {
@@ -47,10 +62,14 @@ class ExprStmt : public Stmt {
 
     std::shared_ptr<Expr> getExpr() { return expr; }
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<ExprStmt> create(std::shared_ptr<PopulateCtx> ctx);
 
+    void collectArrayStores(
+        std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+        std::vector<ArrayStore> &stores) final;
+
   private:
     std::shared_ptr<Expr> expr;
 };
@@ -61,8 +80,8 @@ class DeclStmt : public Stmt {
     DeclStmt(std::shared_ptr<Data> _data, std::shared_ptr<Expr> _expr)
         : data(std::move(_data)), init_expr(std::move(_expr)) {}
     IRNodeKind getKind() final { return IRNodeKind::DECL; }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
 
   private:
     std::shared_ptr<Data> data;
@@ -82,8 +101,8 @@ class StmtBlock : public Stmt {
 
     std::vector<std::shared_ptr<Stmt>> getStmts() { return stmts; }
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") override;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) override;
     static std::shared_ptr<StmtBlock>
     generateStructure(std::shared_ptr<GenCtx> ctx);
     void populate(std::shared_ptr<PopulateCtx> ctx) override;
@@ -95,6 +114,13 @@ class StmtBlock : public Stmt {
                                });
     }
 
+    void collectArrayStores(
+        std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+        std::vector<ArrayStore> &stores) override {
+        for (auto &stmt : stmts)
+            stmt->collectArrayStores(enclosing_loops, stores);
+    }
+
   protected:
     std::vector<std::shared_ptr<Stmt>> stmts;
 };
@@ -102,8 +128,8 @@ class StmtBlock : public Stmt {
 class ScopeStmt : public StmtBlock {
   public:
     IRNodeKind getKind() final { return IRNodeKind::SCOPE; }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<ScopeStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
 };
@@ -114,8 +140,8 @@ class Pragma {
   public:
     explicit Pragma(PragmaKind _kind) : kind(_kind) {}
     PragmaKind getKind() { return kind; }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "");
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0);
     static std::shared_ptr<Pragma> create(std::shared_ptr<PopulateCtx> ctx);
     static std::vector<std::shared_ptr<Pragma>>
     create(size_t num, std::shared_ptr<PopulateCtx> ctx);
@@ -142,12 +168,12 @@ class LoopHead {
     void addSuffix(std::shared_ptr<StmtBlock> _suffix) {
         suffix = std::move(_suffix);
     }
-    void emitPrefix(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset = "");
-    void emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset = "");
-    void emitSuffix(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset = "");
+    void emitPrefix(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                    size_t offset = 0);
+    void emitHeader(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                    size_t offset = 0);
+    void emitSuffix(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+                    size_t offset = 0);
 
     void setIsForeach(bool _val) { is_foreach = _val; }
     bool isForeach() { return is_foreach; }
@@ -156,6 +182,8 @@ class LoopHead {
     populateIterators(std::shared_ptr<PopulateCtx> ctx, size_t _end_val);
     void createPragmas(std::shared_ptr<PopulateCtx> ctx);
     bool hasSIMDPragma();
+    // Code growth of the loop due to its pragmas. It requires the iterators.
+    uint64_t getCompileCostFactor();
 
     static void populateArrays(std::shared_ptr<PopulateCtx> ctx);
 
@@ -191,8 +219,8 @@ class LoopSeqStmt : public LoopStmt {
                 _loop) {
         loops.push_back(std::move(_loop));
     }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<LoopSeqStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
     void populate(std::shared_ptr<PopulateCtx> ctx) override;
@@ -207,6 +235,10 @@ class LoopSeqStmt : public LoopStmt {
             });
     }
 
+    void collectArrayStores(
+        std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+        std::vector<ArrayStore> &stores) final;
+
   private:
     std::vector<
         std::pair<std::shared_ptr<LoopHead>, std::shared_ptr<ScopeStmt>>>
@@ -220,8 +252,8 @@ class LoopNestStmt : public LoopStmt {
         loops.push_back(std::move(_loop));
     }
     void addBody(std::shared_ptr<ScopeStmt> _body) { body = std::move(_body); }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<LoopNestStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
     void populate(std::shared_ptr<PopulateCtx> ctx) override;
@@ -235,6 +267,10 @@ class LoopNestStmt : public LoopStmt {
                body->detectNestedForeach();
     }
 
+    void collectArrayStores(
+        std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+        std::vector<ArrayStore> &stores) final;
+
   private:
     std::vector<std::shared_ptr<LoopHead>> loops;
     std::shared_ptr<StmtBlock> body;
@@ -247,8 +283,8 @@ class IfElseStmt : public Stmt {
         : cond(std::move(_cond)), then_br(std::move(_then_br)),
           else_br(std::move(_else_br)) {}
     IRNodeKind getKind() final { return IRNodeKind::IF_ELSE; }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<IfElseStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
     void populate(std::shared_ptr<PopulateCtx> ctx) final;
@@ -258,6 +294,14 @@ class IfElseStmt : public Stmt {
                (else_br.use_count() != 0 && else_br->detectNestedForeach());
     }
 
+    void collectArrayStores(
+        std::vector<std::shared_ptr<LoopHead>> &enclosing_loops,
+        std::vector<ArrayStore> &stores) final {
+        then_br->collectArrayStores(enclosing_loops, stores);
+        if (else_br.use_count() != 0)
+            else_br->collectArrayStores(enclosing_loops, stores);
+    }
+
   private:
     std::shared_ptr<Expr> cond;
     std::shared_ptr<ScopeStmt> then_br;
@@ -269,8 +313,8 @@ class StubStmt : public Stmt {
     explicit StubStmt(std::string _text) : text(std::move(_text)) {}
     IRNodeKind getKind() final { return IRNodeKind::STUB; }
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, EmitStream &stream,
+              size_t offset = 0) final;
     static std::shared_ptr<StubStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
 
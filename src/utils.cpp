@@ -18,14 +18,16 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 
 #include "utils.h"
+#include "session.h"
 #include "type.h"
+#include <limits>
 #include <memory>
 
 using namespace yarpgen;
 
-std::shared_ptr<RandValGen> yarpgen::rand_val_gen;
+thread_local std::shared_ptr<RandValGen> yarpgen::rand_val_gen;
 
-RandValGen::RandValGen(uint64_t _seed) {
+RandValGen::RandValGen(uint64_t _seed) : seed_version(SeedVersion::V1) {
     if (_seed != 0) {
         seed = _seed;
     }
@@ -33,10 +35,68 @@ RandValGen::RandValGen(uint64_t _seed) {
         std::random_device rd;
         seed = rd();
     }
-    std::cout << "/*SEED " << seed << "*/" << std::endl;
+    // Tests can be generated concurrently, so we print the whole line at once
+    std::cout << "/*SEED " + std::to_string(seed) + "*/\n" << std::flush;
     rand_gen = std::mt19937_64(seed);
 }
 
+// Vose's variant of the algorithm: columns that are underfull are paired with
+// the overfull ones. All of the weights are scaled by the number of columns,
+// so each column has the capacity of total weight and everything stays in
+// integers.
+void AliasTable::build() {
+    size_t num = entries.size();
+    if (num == 0)
+        ERROR("Can't sample an empty distribution");
+    total = 0;
+    for (const auto &entry : entries) {
+        if (entry.threshold > std::numeric_limits<uint64_t>::max() - total)
+            ERROR("Total probability is too big");
+        total += entry.threshold;
+    }
+    // Some of the distributions are emptied by the adjustments of GenPolicy,
+    // e.g., when the last allowed option is removed. All of the options are
+    // equal in that case.
+    if (total == 0) {
+        for (auto &entry : entries)
+            entry.threshold = 1;
+        total = num;
+    }
+    if (total > std::numeric_limits<uint64_t>::max() / num)
+        ERROR("Total probability is too big");
+    range = total * num;
+
+    // Stack of underfull columns grows from the beginning and stack of
+    // the rest of them grows from the end
+    std::vector<size_t> work_list(num);
+    size_t small_end = 0;
+    size_t large_begin = num;
+    for (size_t i = 0; i < num; ++i) {
+        entries[i].threshold *= num;
+        if (entries[i].threshold < total)
+            work_list[small_end++] = i;
+        else
+            work_list[--large_begin] = i;
+    }
+
+    while (small_end > 0 && large_begin < num) {
+        size_t small = work_list[--small_end];
+        size_t large = work_list[large_begin];
+        entries[small].alias = large;
+        entries[large].threshold -= total - entries[small].threshold;
+        if (entries[large].threshold < total) {
+            ++large_begin;
+            work_list[small_end++] = large;
+        }
+    }
+
+    // The rest of the columns are full
+    for (size_t i = 0; i < small_end; ++i)
+        entries[work_list[i]].threshold = total;
+    for (size_t i = large_begin; i < num; ++i)
+        entries[work_list[i]].threshold = total;
+}
+
 #define RandValueCase(__type_id__, gen_name, type_name)                        \
     case __type_id__:                                                          \
         do {                                                                   \
@@ -87,6 +147,11 @@ void RandValGen::setMutationSeed(uint64_t mutation_seed) {
         std::random_device rd;
         mutation_seed = rd();
     }
-    std::cout << "/*MUTATION_SEED " << mutation_seed << "*/" << std::endl;
+    std::cout << "/*MUTATION_SEED " + std::to_string(mutation_seed) + "*/\n"
+              << std::flush;
     prev_gen = std::mt19937_64(mutation_seed);
 }
+
+NameHandler &NameHandler::getInstance() {
+    return GenSession::getCurrent().getNameHandler();
+}
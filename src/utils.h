@@ -27,6 +27,8 @@ limitations under the License.
 #include <random>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace yarpgen {
 
@@ -42,7 +44,7 @@ class IRValue;
     } while (false)
 
 // This class links together id (for example, type of unary operator) and its
-// probability. Usually it is used in the form of std::vector<Probability<id>>
+// probability. Usually it is used in the form of ProbDistr<id> (see below)
 // and defines all possible variants for random decision (probability itself
 // measured in parts, similarly to std::discrete_distribution). Preferably, sum
 // of all probabilities in vector should be 100 (so we can treat 1 part as 1
@@ -50,8 +52,8 @@ class IRValue;
 template <typename T> class Probability {
   public:
     Probability(T _id, uint64_t _prob) : id(_id), prob(_prob) {}
-    T getId() { return id; }
-    uint64_t getProb() { return prob; }
+    T getId() const { return id; }
+    uint64_t getProb() const { return prob; }
 
     void increaseProb(uint64_t add_prob) { prob += add_prob; }
     void zeroProb() { prob = 0; }
@@ -66,6 +68,122 @@ template <typename T> class Probability {
     uint64_t prob;
 };
 
+// Sampler that implements Walker's alias method. It chooses one of N indices
+// with a single random number in O(1), after O(N) initialization. The weights
+// are integers, so the table is exact and doesn't depend on the floating point
+// arithmetic of the platform.
+class AliasTable {
+  public:
+    template <typename T> void init(const std::vector<Probability<T>> &vec) {
+        entries.clear();
+        entries.reserve(vec.size());
+        for (const auto &prob : vec)
+            entries.push_back({prob.getProb(), entries.size()});
+        build();
+    }
+    void reset() { entries.clear(); }
+    bool isReady() const { return !entries.empty(); }
+
+    // Maps random number to the index
+    size_t sample(uint64_t rand_num) const {
+        uint64_t val = rand_num % range;
+        const Entry &entry = entries[val / total];
+        return val % total < entry.threshold ? val / total : entry.alias;
+    }
+
+  private:
+    void build();
+
+    // Each column holds the index itself with probability threshold / total
+    // and the alias otherwise
+    struct Entry {
+        uint64_t threshold;
+        size_t alias;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    uint64_t range = 0;
+};
+
+// Distribution of IDs, i.e. std::vector<Probability<id>>. GenPolicy is copied
+// every time when some part of the generator needs to adjust it, while most of
+// the distributions stay the same. Therefore, copies of the distribution share
+// the underlying vector, and it is duplicated only when one of them is
+// modified (copy-on-write). Read-only access goes through get() and the const
+// interface, while getMutable() returns a vector that is safe to modify.
+// The samplers that are used by RandValGen::getRandId are cached alongside
+// the vector, so they are shared between the copies as well. They are
+// dropped by getMutable(), so the vector shouldn't be modified through
+// the reference after the next random choice.
+template <typename T> class ProbDistr {
+  public:
+    using VecType = std::vector<Probability<T>>;
+
+    ProbDistr() = default;
+    ProbDistr(VecType _vec) : data(std::make_shared<Data>(std::move(_vec))) {}
+
+    const VecType &get() const {
+        static const VecType empty_vec;
+        return data ? data->vec : empty_vec;
+    }
+    VecType &getMutable() {
+        if (!data)
+            data = std::make_shared<Data>(VecType());
+        else if (data.use_count() > 1)
+            data = std::make_shared<Data>(data->vec);
+        else {
+            data->discrete_distr_ready = false;
+            data->alias_table.reset();
+        }
+        return data->vec;
+    }
+
+    std::discrete_distribution<size_t> &getDiscreteDistr() const {
+        if (!data || data->vec.empty())
+            ERROR("Can't sample an empty distribution");
+        if (!data->discrete_distr_ready) {
+            std::vector<double> weights;
+            weights.reserve(data->vec.size());
+            for (const auto &prob : data->vec)
+                weights.push_back(static_cast<double>(prob.getProb()));
+            data->discrete_distr = std::discrete_distribution<size_t>(
+                weights.begin(), weights.end());
+            data->discrete_distr_ready = true;
+        }
+        return data->discrete_distr;
+    }
+
+    const AliasTable &getAliasTable() const {
+        if (!data || data->vec.empty())
+            ERROR("Can't sample an empty distribution");
+        if (!data->alias_table.isReady())
+            data->alias_table.init(data->vec);
+        return data->alias_table;
+    }
+
+    typename VecType::const_iterator begin() const { return get().begin(); }
+    typename VecType::const_iterator end() const { return get().end(); }
+    size_t size() const { return get().size(); }
+    bool empty() const { return get().empty(); }
+
+    template <typename... Args> void emplace_back(Args &&...args) {
+        getMutable().emplace_back(std::forward<Args>(args)...);
+    }
+    void clear() { getMutable().clear(); }
+
+  private:
+    struct Data {
+        explicit Data(VecType _vec)
+            : vec(std::move(_vec)), discrete_distr_ready(false) {}
+        VecType vec;
+        // Lazily initialized samplers
+        std::discrete_distribution<size_t> discrete_distr;
+        bool discrete_distr_ready;
+        AliasTable alias_table;
+    };
+    std::shared_ptr<Data> data;
+};
+
 template <class T>
 typename std::enable_if<!std::is_enum<T>::value, std::ostream &>::type
 operator<<(std::ostream &os, const Probability<T> &_prob) {
@@ -120,15 +238,43 @@ class RandValGen {
     IRValue getRandValue(IntTypeID type_id);
 
     // Randomly chooses one of IDs, basing on std::vector<Probability<id>>.
-    template <typename T> T getRandId(std::vector<Probability<T>> vec) {
-        std::vector<double> discrete_dis_init;
-        for (auto i : vec)
-            discrete_dis_init.push_back(static_cast<double>(i.getProb()));
+    template <typename T> T getRandId(const std::vector<Probability<T>> &vec) {
+        if (seed_version == SeedVersion::V1) {
+            std::vector<double> discrete_dis_init;
+            discrete_dis_init.reserve(vec.size());
+            for (const auto &i : vec)
+                discrete_dis_init.push_back(static_cast<double>(i.getProb()));
+
+            std::discrete_distribution<size_t> discrete_dis(
+                discrete_dis_init.begin(), discrete_dis_init.end());
+            size_t idx = discrete_dis(rand_gen);
+            return vec.at(idx).getId();
+        }
 
-        std::discrete_distribution<size_t> discrete_dis(
-            discrete_dis_init.begin(), discrete_dis_init.end());
-        size_t idx = discrete_dis(rand_gen);
-        return vec.at(idx).getId();
+        // The vector is temporary, so it is not worth to build a sampler
+        if (vec.empty())
+            ERROR("Can't sample an empty distribution");
+        uint64_t total_prob = 0;
+        for (const auto &i : vec)
+            total_prob += i.getProb();
+        // All of the options are equal, see AliasTable::build()
+        if (total_prob == 0)
+            return vec[rand_gen() % vec.size()].getId();
+        uint64_t val = rand_gen() % total_prob;
+        for (const auto &i : vec) {
+            if (val < i.getProb())
+                return i.getId();
+            val -= i.getProb();
+        }
+        ERROR("Unreachable");
+    }
+
+    // The same, but the sampler is reused between the calls
+    template <typename T> T getRandId(const ProbDistr<T> &distr) {
+        size_t idx = seed_version == SeedVersion::V1
+                         ? distr.getDiscreteDistr()(rand_gen)
+                         : distr.getAliasTable().sample(rand_gen());
+        return distr.get()[idx].getId();
     }
 
     // Randomly choose element from a vector
@@ -169,6 +315,8 @@ class RandValGen {
         uint64_t total_prob = 0;
         std::vector<double> discrete_dis_init;
         std::vector<Probability<T>> new_prob;
+        discrete_dis_init.reserve(prob_vec.size());
+        new_prob.reserve(prob_vec.size());
         for (auto i : prob_vec) {
             total_prob += i.getProb();
             discrete_dis_init.push_back(static_cast<double>(i.getProb()));
@@ -185,16 +333,24 @@ class RandValGen {
             new_prob.at(static_cast<size_t>(discrete_dis(rand_gen)))
                 .increaseProb(delta);
 
-        prob_vec = new_prob;
+        prob_vec = std::move(new_prob);
+    }
+
+    template <typename T> void shuffleProb(ProbDistr<T> &distr) {
+        shuffleProb(distr.getMutable());
     }
 
     uint64_t getSeed() const { return seed; }
     void setSeed(uint64_t new_seed);
+    SeedVersion getSeedVersion() const { return seed_version; }
+    void setSeedVersion(SeedVersion val) { seed_version = val; }
     void switchMutationStates();
     void setMutationSeed(uint64_t mutation_seed);
 
   private:
     uint64_t seed;
+    // Algorithms of the random choices that map the seed to the test
+    SeedVersion seed_version;
     std::mt19937_64 rand_gen;
     // Auxiliary random generator, used for mutation
     std::mt19937_64 prev_gen;
@@ -205,14 +361,13 @@ template <> inline bool RandValGen::getRandValue<bool>(bool from, bool to) {
     return (bool)dis(rand_gen);
 }
 
-extern std::shared_ptr<RandValGen> rand_val_gen;
+// Random value generator of the generation session that is active in the
+// current thread
+extern thread_local std::shared_ptr<RandValGen> rand_val_gen;
 
 class NameHandler {
   public:
-    static NameHandler &getInstance() {
-        static NameHandler instance;
-        return instance;
-    }
+    static NameHandler &getInstance();
     NameHandler(const NameHandler &root) = delete;
     NameHandler &operator=(const NameHandler &) = delete;
 
@@ -222,6 +377,7 @@ class NameHandler {
     std::string getIterName() { return "i_" + std::to_string(iter_idx++); }
 
   private:
+    friend class GenSession;
     NameHandler() : var_idx(0), arr_idx(0), iter_idx(0), stub_stmt_idx(0) {}
 
     uint32_t var_idx;
@@ -0,0 +1,381 @@
+/*
+Copyright (c) 2019-2020, Intel Corporation
+Copyright (c) 2019-2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Throughput benchmark of the generator. It generates a fixed corpus of seeds
+// for each language standard and options profile and reports tests/sec,
+// statements/sec, emitted bytes/sec and memory usage. Each profile is run in
+// its own process, so its peak RSS doesn't depend on the other profiles. The
+// results can be saved as a baseline and compared against it later.
+// Usage: yarpgen_bench [--seeds=<num>] [--repeats=<num>] [--out-dir=<dir>]
+//                      [--baseline=<file>] [--save-baseline=<file>]
+//                      [--tolerance=<percent>]
+
+#include "options.h"
+#include "program.h"
+#include "session.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace yarpgen;
+
+// The corpus is a part of the baseline. Any change of the seeds or of the
+// profiles or of the metrics has to bump the version, so the old baselines
+// are rejected.
+static const size_t CORPUS_VERSION = 4;
+
+struct BenchProfile {
+    std::string name;
+    // Command-line options of the generator
+    std::vector<std::string> args;
+};
+
+struct BenchCorpus {
+    std::string lang_std;
+    std::vector<uint64_t> seeds;
+};
+
+// Most of the ISPC and SYCL seeds produce tests with only a few statements, so
+// their corpora consist of the seeds that generate at least 100 lines of code
+static const std::vector<BenchCorpus> corpora = {
+    {"c", {1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+           11, 12, 13, 14, 15, 16, 17, 18, 19, 20}},
+    {"c++", {1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+             11, 12, 13, 14, 15, 16, 17, 18, 19, 20}},
+    {"ispc", {5, 6, 11, 19, 22, 26, 27, 30, 32, 35,
+              40, 41, 52, 54, 56, 58, 59, 60, 67, 70}},
+    {"sycl", {3, 13, 26, 27, 36, 61, 62, 70, 72, 75,
+              76, 102, 111, 114, 118, 120, 133, 145, 146, 160}}};
+static const size_t CORPUS_MAX_SEEDS_NUM = 20;
+
+static const std::vector<BenchProfile> option_profiles = {
+    {"default", {}},
+    {"compact-driver", {"--compact-driver=true"}},
+    {"seed-version-2", {"--seed-version=2"}}};
+
+struct BenchResult {
+    double tests_per_sec = 0;
+    double stmts_per_sec = 0;
+    double bytes_per_sec = 0;
+    // Maximal peak size of the live IR over the tests (in bytes)
+    size_t peak_ir_size = 0;
+    // Peak RSS of the process that ran the profile (in KB)
+    size_t peak_rss = 0;
+};
+
+static size_t getDirSize(const std::filesystem::path &dir) {
+    size_t ret = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir))
+        if (entry.is_regular_file())
+            ret += entry.file_size();
+    return ret;
+}
+
+// Stream buffer that drops everything. The generator reports the seed to
+// stdout, and we don't want it in the report.
+class NullBuffer : public std::streambuf {
+  protected:
+    int overflow(int c) override { return c; }
+};
+
+// Generates the corpus for the profile several times and uses the fastest pass,
+// because the time of a single pass is too noisy
+static BenchResult runProfile(const BenchCorpus &corpus,
+                              const BenchProfile &profile, size_t seeds_num,
+                              size_t repeats_num,
+                              const std::filesystem::path &out_dir) {
+    std::vector<std::string> args = {"yarpgen_bench",
+                                     "--std=" + corpus.lang_std};
+    args.insert(args.end(), profile.args.begin(), profile.args.end());
+    std::vector<char *> argv;
+    for (auto &arg : args)
+        argv.push_back(&arg[0]);
+
+    BenchResult ret;
+    size_t stmts_num = 0;
+    size_t bytes_num = 0;
+    double best_secs = 0;
+    NullBuffer null_buf;
+    for (size_t repeat = 0; repeat < repeats_num; ++repeat) {
+        std::chrono::steady_clock::duration total_time{};
+        stmts_num = 0;
+        bytes_num = 0;
+        for (size_t i = 0; i < seeds_num; ++i) {
+            std::filesystem::remove_all(out_dir);
+            std::filesystem::create_directories(out_dir);
+
+            auto start = std::chrono::steady_clock::now();
+            auto cout_buf = std::cout.rdbuf(&null_buf);
+            {
+                GenSession session;
+                session.setRandValGen(
+                    std::make_shared<RandValGen>(corpus.seeds.at(i)));
+                GenSession::setCurrent(&session);
+
+                OptionParser::parse(argv.size(), argv.data());
+                Options &options = Options::getInstance();
+                options.setSeed(rand_val_gen->getSeed());
+                rand_val_gen->setSeedVersion(options.getSeedVersion());
+                options.setOutDir(out_dir.string());
+
+                ProgramGenerator new_program;
+                new_program.emit();
+
+                stmts_num += session.getStatistics().getStmtNum();
+                ret.peak_ir_size =
+                    std::max(ret.peak_ir_size,
+                             session.getStatistics().getPeakIRSize());
+                GenSession::setCurrent(nullptr);
+            }
+            std::cout.rdbuf(cout_buf);
+            total_time += std::chrono::steady_clock::now() - start;
+
+            bytes_num += getDirSize(out_dir);
+        }
+
+        double secs = std::chrono::duration<double>(total_time).count();
+        if (repeat == 0 || secs < best_secs)
+            best_secs = secs;
+    }
+
+    ret.tests_per_sec = static_cast<double>(seeds_num) / best_secs;
+    ret.stmts_per_sec = static_cast<double>(stmts_num) / best_secs;
+    ret.bytes_per_sec = static_cast<double>(bytes_num) / best_secs;
+    return ret;
+}
+
+// Runs the profile in a child process and takes its peak RSS. Where fork() is
+// not available, the profile is run in this process and the RSS is not known.
+static BenchResult runProfileInChild(const BenchCorpus &corpus,
+                                     const BenchProfile &profile,
+                                     size_t seeds_num, size_t repeats_num,
+                                     const std::filesystem::path &out_dir) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fds[2];
+    if (pipe(fds) != 0)
+        ERROR("Can't create a pipe");
+    pid_t pid = fork();
+    if (pid < 0)
+        ERROR("Can't create a process");
+    if (pid == 0) {
+        close(fds[0]);
+        BenchResult ret =
+            runProfile(corpus, profile, seeds_num, repeats_num, out_dir);
+        ssize_t size = write(fds[1], &ret, sizeof(ret));
+        _exit(size == sizeof(ret) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    BenchResult ret;
+    ssize_t size = read(fds[0], &ret, sizeof(ret));
+    close(fds[0]);
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0 || size != sizeof(ret))
+        ERROR("Profile " + corpus.lang_std + "/" + profile.name + " failed");
+#if defined(__APPLE__)
+    ret.peak_rss = static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+    ret.peak_rss = static_cast<size_t>(usage.ru_maxrss);
+#endif
+    return ret;
+#else
+    return runProfile(corpus, profile, seeds_num, repeats_num, out_dir);
+#endif
+}
+
+// Baseline format: a header line with the corpus parameters, then a line with
+// the name and the results for each profile
+static void saveBaseline(const std::string &file_name, size_t seeds_num,
+                         const std::map<std::string, BenchResult> &results) {
+    std::ofstream out_file(file_name);
+    if (!out_file)
+        ERROR("Can't open file " + file_name);
+    out_file << "yarpgen_bench corpus " << CORPUS_VERSION << " seeds "
+             << seeds_num << "\n";
+    out_file << std::setprecision(10);
+    for (const auto &result : results)
+        out_file << result.first << " " << result.second.tests_per_sec << " "
+                 << result.second.stmts_per_sec << " "
+                 << result.second.bytes_per_sec << " "
+                 << result.second.peak_ir_size << " "
+                 << result.second.peak_rss << "\n";
+}
+
+static std::map<std::string, BenchResult>
+loadBaseline(const std::string &file_name, size_t seeds_num) {
+    std::ifstream inp_file(file_name);
+    if (!inp_file)
+        ERROR("Can't open file " + file_name);
+    std::string tool, corpus, seeds;
+    size_t corpus_version = 0, baseline_seeds_num = 0;
+    inp_file >> tool >> corpus >> corpus_version >> seeds >>
+        baseline_seeds_num;
+    if (tool != "yarpgen_bench" || corpus != "corpus" || seeds != "seeds")
+        ERROR("Bad baseline file " + file_name);
+    if (corpus_version != CORPUS_VERSION || baseline_seeds_num != seeds_num)
+        ERROR("Baseline " + file_name + " was made with a different corpus");
+
+    std::map<std::string, BenchResult> ret;
+    std::string name;
+    BenchResult result;
+    while (inp_file >> name >> result.tests_per_sec >> result.stmts_per_sec >>
+           result.bytes_per_sec >> result.peak_ir_size >> result.peak_rss)
+        ret[name] = result;
+    return ret;
+}
+
+// Prints the relative change of the metric. Returns true if it is a regression
+static bool compareMetric(const std::string &name, double new_val,
+                          double base_val, bool higher_is_better,
+                          double tolerance) {
+    double change = base_val != 0 ? (new_val - base_val) / base_val : 0;
+    bool regression =
+        higher_is_better ? change < -tolerance : change > tolerance;
+    std::cout << "    " << std::left << std::setw(16) << name << std::right
+              << std::showpos << std::fixed << std::setprecision(1)
+              << std::setw(8) << change * 100 << "%" << std::noshowpos
+              << (regression ? "  REGRESSION" : "") << "\n";
+    return regression;
+}
+
+static std::string getArgValue(const std::string &arg,
+                               const std::string &name) {
+    return arg.substr(name.size() + 1);
+}
+
+int main(int argc, char *argv[]) {
+    size_t seeds_num = 10;
+    size_t repeats_num = 5;
+    std::string baseline_file;
+    std::string save_baseline_file;
+    double tolerance = 0.1;
+    std::filesystem::path out_dir =
+        std::filesystem::temp_directory_path() / "yarpgen_bench";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto starts_with = [&arg](const std::string &name) {
+            return arg.rfind(name + "=", 0) == 0;
+        };
+        if (starts_with("--seeds")) {
+            std::stringstream arg_ss(getArgValue(arg, "--seeds"));
+            arg_ss >> seeds_num;
+            if (seeds_num == 0 || seeds_num > CORPUS_MAX_SEEDS_NUM)
+                ERROR("The number of seeds should be between 1 and " +
+                      std::to_string(CORPUS_MAX_SEEDS_NUM));
+        }
+        else if (starts_with("--repeats")) {
+            std::stringstream arg_ss(getArgValue(arg, "--repeats"));
+            arg_ss >> repeats_num;
+            if (repeats_num == 0)
+                ERROR("The number of repeats should be a positive number");
+        }
+        else if (starts_with("--out-dir"))
+            out_dir = getArgValue(arg, "--out-dir");
+        else if (starts_with("--baseline"))
+            baseline_file = getArgValue(arg, "--baseline");
+        else if (starts_with("--save-baseline"))
+            save_baseline_file = getArgValue(arg, "--save-baseline");
+        else if (starts_with("--tolerance")) {
+            std::stringstream arg_ss(getArgValue(arg, "--tolerance"));
+            arg_ss >> tolerance;
+            tolerance /= 100;
+        }
+        else
+            ERROR("Unknown option: " + arg);
+    }
+
+    OptionParser::initOptions();
+
+    std::cout << "Corpus version " << CORPUS_VERSION << ", " << seeds_num
+              << " seeds per profile\n";
+    std::cout << std::left << std::setw(24) << "profile" << std::right
+              << std::setw(10) << "tests/s" << std::setw(12) << "stmts/s"
+              << std::setw(12) << "KB/s" << std::setw(12) << "Peak IR KB"
+              << std::setw(12) << "RSS KB" << "\n";
+    std::map<std::string, BenchResult> results;
+    for (const auto &corpus : corpora)
+        for (const auto &profile : option_profiles) {
+            std::string name = corpus.lang_std + "/" + profile.name;
+            BenchResult result = runProfileInChild(corpus, profile, seeds_num,
+                                                   repeats_num, out_dir);
+            results[name] = result;
+            std::cout << std::left << std::setw(24) << name << std::right
+                      << std::fixed << std::setprecision(2) << std::setw(10)
+                      << result.tests_per_sec << std::setw(12)
+                      << std::setprecision(0) << result.stmts_per_sec
+                      << std::setw(12) << result.bytes_per_sec / 1024
+                      << std::setw(12) << result.peak_ir_size / 1024
+                      << std::setw(12) << result.peak_rss << std::endl;
+        }
+    std::filesystem::remove_all(out_dir);
+
+    if (!save_baseline_file.empty())
+        saveBaseline(save_baseline_file, seeds_num, results);
+
+    if (baseline_file.empty())
+        return 0;
+
+    bool regression = false;
+    auto baseline = loadBaseline(baseline_file, seeds_num);
+    std::cout << "\nComparison with " << baseline_file << " (tolerance "
+              << tolerance * 100 << "%):\n";
+    for (const auto &result : results) {
+        auto find_res = baseline.find(result.first);
+        if (find_res == baseline.end()) {
+            std::cout << result.first << ": no baseline\n";
+            continue;
+        }
+        const BenchResult &base = find_res->second;
+        const BenchResult &cur = result.second;
+        std::cout << result.first << ":\n";
+        regression |= compareMetric("tests/s", cur.tests_per_sec,
+                                    base.tests_per_sec, true, tolerance);
+        regression |= compareMetric("stmts/s", cur.stmts_per_sec,
+                                    base.stmts_per_sec, true, tolerance);
+        regression |= compareMetric("bytes/s", cur.bytes_per_sec,
+                                    base.bytes_per_sec, true, tolerance);
+        regression |= compareMetric(
+            "Peak IR size", static_cast<double>(cur.peak_ir_size),
+            static_cast<double>(base.peak_ir_size), false, tolerance);
+        regression |= compareMetric("peak RSS",
+                                    static_cast<double>(cur.peak_rss),
+                                    static_cast<double>(base.peak_rss), false,
+                                    tolerance);
+    }
+    return regression ? 1 : 0;
+}